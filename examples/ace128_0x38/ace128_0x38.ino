@@ -36,9 +36,10 @@ void setup() {
 
 
 void loop() {
-  pos = myACE.pos();                 // get logical position - signed -64 to +63
-  upos = myACE.upos();               // get logical position - unsigned 0 to +127
-  mpos = myACE.mpos();               // get multiturn position - signed -32768 to +32767
+  ACE128sample now = myACE.sample(); // one read of the module gives us all three forms
+  pos = now.pos;                     // get logical position - signed -64 to +63
+  upos = now.upos;                   // get logical position - unsigned 0 to +127
+  mpos = now.mpos;                   // get multiturn position - signed -32768 to +32767
 
   if (upos != oldPos) {            // did we move?
     oldPos = upos;                 // remember where we are
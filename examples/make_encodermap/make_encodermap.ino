@@ -3,6 +3,7 @@
 // we just need to make a different mapping table
 // the example spits out content on the serial monitor that can be pasted into a text editor to
 // make the alternate map table .h file
+// ACE128map.h in the library does the same at compile time - e.g. ACE128map<1,2,3,4,5,6,7,8>::table
 
 // edit pinOrder and pinString for your encoder pins from pin 0 to 7 on your IO expander
 byte pinOrder[] = {1, 2, 3, 4, 5, 6, 7, 8};   // used for calculation
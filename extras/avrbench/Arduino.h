@@ -0,0 +1,65 @@
+#ifndef ACE128_avrbench_Arduino_h
+#define ACE128_avrbench_Arduino_h
+/*
+  Arduino.h - the parts of the Arduino AVR core ACE128 uses, for the cycle benchmark
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  The benchmark is built without the core so the figures are the library's own. It builds as an Uno would, with
+  the AVR EEPROM as the default and port register pin reads. The port registers are bench_port[] in RAM, which the
+  benchmark steps through the codes - a load from there takes the same 2 cycles as one from a PINx register.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef ARDUINO_ARCH_AVR
+  #define ARDUINO_ARCH_AVR
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define NOT_A_PIN 0
+
+extern volatile uint8_t bench_port[3]; // stand in for PINB, PINC and PIND
+extern volatile unsigned long bench_ms;
+
+// Uno numbering: 0 - 7 on port D, 8 - 13 on port B, 14 - 19 (A0 - A5) on port C. Ports 1 - 3 are B, C, D
+#define digitalPinToPort(p) ((p) < 8 ? 3 : (p) < 14 ? 1 : (p) < 20 ? 2 : NOT_A_PIN)
+#define digitalPinToBitMask(p) (1 << ((p) < 8 ? (p) : (p) < 14 ? (p) - 8 : (p) - 14))
+#define portInputRegister(port) (&bench_port[(port) - 1])
+
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline int digitalRead(uint8_t pin)
+{
+  return ((*portInputRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin)) ? HIGH : LOW);
+}
+
+// as the core does it - interrupts held off while the 4 bytes are copied
+inline unsigned long millis()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long ms = bench_ms;
+  SREG = oldSREG;
+  return (ms);
+}
+
+inline unsigned long micros()
+{
+  return (millis() * 1000);
+}
+
+inline void noInterrupts() { cli(); }
+inline void interrupts() { sei(); }
+
+#endif // ACE128_avrbench_Arduino_h
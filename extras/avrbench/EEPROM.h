@@ -0,0 +1,37 @@
+#ifndef ACE128_avrbench_EEPROM_h
+#define ACE128_avrbench_EEPROM_h
+/*
+  EEPROM.h - a stand-in AVR EEPROM for the cycle benchmark
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  64 bytes of RAM, so writes cost no 3.3ms write cycle and the counts are the library's own work.
+*/
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+    uint8_t read(int idx) { return (_mem[idx & 63]); }
+    void write(int idx, uint8_t val) { _mem[idx & 63] = val; }
+    void update(int idx, uint8_t val) { if (read(idx) != val) write(idx, val); }
+    template <typename T> T &get(int idx, T &t)
+    {
+      uint8_t *p = (uint8_t *)&t;
+      for (uint8_t i = 0; i < sizeof(T); i++) *p++ = read(idx + i);
+      return (t);
+    }
+    template <typename T> const T &put(int idx, const T &t)
+    {
+      const uint8_t *p = (const uint8_t *)&t;
+      for (uint8_t i = 0; i < sizeof(T); i++) update(idx + i, *p++);
+      return (t);
+    }
+  private:
+    uint8_t _mem[64];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // ACE128_avrbench_EEPROM_h
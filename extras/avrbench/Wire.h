@@ -0,0 +1,42 @@
+#ifndef ACE128_avrbench_Wire_h
+#define ACE128_avrbench_Wire_h
+/*
+  Wire.h - a stand-in I2C bus for the cycle benchmark
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Every transaction succeeds at once. Pin expanders answer with bench_gpio and the EEPROM at 0x50 reads blank,
+  so the cycle counts are the library's own work, without the 100us or so each byte takes on a real bus.
+*/
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+extern volatile uint8_t bench_gpio;  // pins of every expander on the bus
+
+class TwoWire
+{
+  public:
+    void begin() {}
+    void setClock(uint32_t clock) { (void)clock; }
+    void beginTransmission(uint8_t addr) { _addr = addr; }
+    void beginTransmission(int addr) { _addr = addr; }
+    size_t write(uint8_t data) { (void)data; return (1); }
+    uint8_t endTransmission(bool sendStop = true) { (void)sendStop; return (0); }
+    uint8_t requestFrom(int addr, int len) { _addr = addr; _left = len; return (len); }
+    int available() { return (_left); }
+    int read()
+    {
+      if (_left == 0) return (-1);
+      _left--;
+      return (_addr == 0x50 ? 0xFF : bench_gpio);
+    }
+  private:
+    uint8_t _addr;
+    uint8_t _left;
+};
+
+extern TwoWire Wire;
+
+#endif // ACE128_avrbench_Wire_h
@@ -0,0 +1,133 @@
+/*
+  bench.cpp - cycles per call for ACE128 on an ATmega328P, run under simavr by bench.sh
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Each call is timed with Timer1 running at the CPU clock, less the cost of reading the timer, and averaged over
+  a sweep of all 128 positions so map lookups, recovery and rollovers are all in the mix. The knob is wired as on
+  the author's modules (87654321) to a PCF8574 at 0x20, an MCP23008 at 0x00 or pins 2 - 9, as the configuration says.
+  _raw2pos() is the difference between pos() and rawPos().
+  The results go to simavr's console as one line:  cycles <acePins> <rawPos> <pos> <upos> <mpos> <sample>
+*/
+
+#include <avr/sleep.h>
+#include <ACE128.h>
+#include <ACE128map.h>
+#ifndef ACE128_COMPACT_MAP
+  #include <ACE128map87654321.h>
+#endif
+
+typedef ACE128map<8, 7, 6, 5, 4, 3, 2, 1> Wiring;
+
+volatile uint8_t bench_port[3];
+volatile unsigned long bench_ms;
+volatile uint8_t bench_gpio;
+#ifdef ACE128_I2C
+TwoWire Wire;
+#endif
+#ifdef ACE128_EEPROM_AVR
+EEPROMClass EEPROM;
+#endif
+
+#ifdef ACE128_COMPACT_MAP
+  #define BENCH_MAP Wiring::order
+#else
+  #define BENCH_MAP encoderMap_87654321
+#endif
+
+#if defined(ACE128_ARDUINO_PINS)
+  #define BENCH_ENCODER 2, 3, 4, 5, 6, 7, 8, 9, (uint8_t *)BENCH_MAP
+#elif defined(ACE128_MCP23008)
+  #define BENCH_ENCODER 0x00, (uint8_t *)BENCH_MAP
+#else
+  #define BENCH_ENCODER 0x20, (uint8_t *)BENCH_MAP
+#endif
+
+#ifdef ACE128_EEPROM_NONE
+ACE128 knob(BENCH_ENCODER);
+#else
+ACE128 knob(BENCH_ENCODER, 0);
+#endif
+
+uint8_t codes[128];                // gray code at each raw position
+volatile int16_t sink;             // results go here so the calls can't be optimised away
+uint16_t overhead;                 // cycles to start and read the timer
+
+static void setCode(uint8_t code)
+{
+#ifdef ACE128_ARDUINO_PINS
+  bench_port[2] = code << 2;       // pins 2 - 7 are PD2 - PD7
+  bench_port[0] = code >> 6;       // pins 8 and 9 are PB0 and PB1
+#else
+  bench_gpio = code;
+#endif
+}
+
+static void console(const char *s)
+{
+  while (*s) GPIOR0 = *s++;
+}
+
+static void console(uint16_t n)
+{
+  char buf[6];
+  uint8_t i = sizeof(buf);
+  buf[--i] = 0;
+  do {
+    buf[--i] = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  console(buf + i);
+}
+
+// one timed call, added to total
+#define BENCH(total, call) do { TCNT1 = 0; sink = call; uint16_t t = TCNT1; total += t - overhead; } while (0)
+
+int main()
+{
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);              // Timer1 at the CPU clock
+  overhead = 0xFFFF;
+  for (uint8_t i = 0; i < 8; i++) {
+    TCNT1 = 0;
+    sink = 0;
+    uint16_t t = TCNT1;
+    if (t < overhead) overhead = t;
+  }
+  for (uint8_t raw = 0; raw < 128; raw++) {
+    codes[raw] = Wiring::code(raw);
+  }
+
+  setCode(codes[0]);
+  knob.begin();
+  uint32_t acePins = 0, rawPos = 0, pos = 0, upos = 0, mpos = 0, sample = 0;
+  for (uint8_t i = 0; i < 128; i++) {
+    setCode(codes[(i * 3) & 127]); // three steps a read, so the sweep goes round three times
+    bench_ms += 10;
+    BENCH(acePins, knob.acePins());
+    BENCH(rawPos, knob.rawPos());
+    BENCH(pos, knob.pos());
+    BENCH(upos, knob.upos());
+    BENCH(mpos, knob.mpos());
+    BENCH(sample, knob.sample().mpos);
+  }
+  console("cycles ");
+  console(acePins / 128);
+  console(" ");
+  console(rawPos / 128);
+  console(" ");
+  console(pos / 128);
+  console(" ");
+  console(upos / 128);
+  console(" ");
+  console(mpos / 128);
+  console(" ");
+  console(sample / 128);
+  console("\n");
+
+  cli();                           // simavr stops on sleep with interrupts off
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+  return (0);
+}
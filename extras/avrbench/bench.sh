@@ -0,0 +1,51 @@
+#!/bin/sh
+# bench.sh - cycles per call and flash and RAM use of ACE128 on an ATmega328P, one configuration per row
+# Copyright (c) 2013-2019 Alastair Young.
+# This project is licensed under the terms of the MIT license.
+#
+# Builds bench.cpp with avr-gcc for each configuration below, runs it under simavr and prints a table:
+#   extras/avrbench/bench.sh                       the standard configurations
+#   extras/avrbench/bench.sh "velocity|-DACE128_EEPROM_NONE -DACE128_VELOCITY"   and any more you give it
+# Needs avr-gcc, avr-size and simavr on the path, and simavr's avr_mcu_section.h - set SIMAVR_INCLUDE to the
+# directory holding it if it isn't in /usr/include/simavr/avr. Sizes are the whole benchmark, so compare rows
+# rather than reading them as the library alone. Neither sizes nor cycles include the bus driver: Wire.h here is a
+# C++ stub that answers every transaction at once, without the Wire and twi code (and its buffers) a sketch links in,
+# and EEPROM.h is 64 bytes of RAM. Cycle counts leave out bus and EEPROM write time.
+#
+# Not yet run - written without avr-gcc or simavr to hand, so the first run may need fixes here or in simavr.c.
+
+set -e
+here=$(cd "$(dirname "$0")" && pwd)
+src="$here/../../src"
+inc=${SIMAVR_INCLUDE:-/usr/include/simavr/avr}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+mcu="-mmcu=atmega328p -DF_CPU=16000000UL"
+cxxflags="-Os -std=gnu++11 -fno-exceptions -fno-threadsafe-statics -ffunction-sections -fdata-sections -Wl,--gc-sections"
+avr-gcc $mcu -Os -I"$inc" -c "$here/simavr.c" -o "$out/simavr.o"
+
+printf '%-24s %6s %5s %5s %8s %7s %5s %5s %5s %7s\n' config text data bss acePins rawPos pos upos mpos sample
+{
+  cat <<CONFIGS
+PCF8574|-DACE128_EEPROM_NONE
+PCF8574 AVR EEPROM|-DACE128_EEPROM_AVR
+PCF8574 I2C EEPROM|-DACE128_EEPROM_I2C
+PCF8574 journal|-DACE128_EEPROM_AVR -DACE128_EEPROM_JOURNAL=8
+MCP23008|-DACE128_EEPROM_NONE -DACE128_MCP23008
+MCP23008 I2C EEPROM|-DACE128_EEPROM_I2C -DACE128_MCP23008
+pins|-DACE128_EEPROM_NONE -DACE128_ARDUINO_PINS
+pins AVR EEPROM|-DACE128_EEPROM_AVR -DACE128_ARDUINO_PINS
+compact map|-DACE128_EEPROM_NONE -DACE128_COMPACT_MAP
+recover|-DACE128_EEPROM_NONE -DACE128_RECOVER
+CONFIGS
+  for extra in "$@"; do echo "$extra"; done
+} | while IFS='|' read -r name flags; do
+  # shellcheck disable=SC2086
+  avr-g++ $mcu $cxxflags $flags -I"$here" -I"$src" "$here/bench.cpp" "$out/simavr.o" -o "$out/bench.elf"
+  sizes=$(avr-size -A "$out/bench.elf" | awk '$1 == ".text" { t = $2 } $1 == ".data" { d = $2 } $1 == ".bss" { b = $2 } END { print t, d, b }')
+  cycles=$(simavr "$out/bench.elf" 2>&1 | sed 's/\x1b\[[0-9;]*m//g' | sed -n 's/.*cycles \([0-9 ]*\).*/\1/p')
+  # shellcheck disable=SC2086
+  printf '%-24s %6s %5s %5s %8s %7s %5s %5s %5s %7s\n' "$name" $sizes ${cycles:-"- - - - - -"}
+done
+echo "sizes and cycles exclude the bus driver - Wire and EEPROM are stand-ins that answer from RAM"
@@ -0,0 +1,13 @@
+/*
+  simavr.c - tells simavr which chip and clock the benchmark wants and which register is its console
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Kept apart from bench.cpp because simavr's section macros are C, not C++.
+*/
+
+#include <avr/io.h>
+#include "avr_mcu_section.h"
+
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
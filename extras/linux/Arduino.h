@@ -0,0 +1,80 @@
+#ifndef ACE128_linux_Arduino_h
+#define ACE128_linux_Arduino_h
+/*
+  Arduino.h - just enough of the Arduino core to build ACE128 on Linux
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Put this directory ahead of the library's src directory on the include path:
+    g++ -std=gnu++11 -I extras/linux -I src myknobs.cpp
+  The knobs have to be on pin expanders - there are no Arduino pins here, so ACE128_ARDUINO_PINS won't work
+  and ACE128_INTERRUPT has nothing to watch. ACE128_EEPROM_NONE is the default, or use ACE128_EEPROM_I2C.
+  ace128replay.cpp here plays back ACE128_TRACE recordings.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+// the maps are plain const arrays here
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+inline unsigned long micros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((unsigned long)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000);
+}
+
+inline unsigned long millis()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((unsigned long)ts.tv_sec * 1000UL + ts.tv_nsec / 1000000);
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+  struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+  nanosleep(&ts, NULL);
+}
+
+inline void delay(unsigned long ms)
+{
+  struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+  nanosleep(&ts, NULL);
+}
+
+// no GPIO - an INT pin reads as "changed" so every read goes to the bus
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline int digitalRead(uint8_t pin) { (void)pin; return (LOW); }
+
+// a single threaded program has nothing to hold off
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// enough of Print for ACE128_TRACE - derive from it to send a trace to a file or a socket
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+      size_t n = 0;
+      while (len--) n += write(*buf++);
+      return (n);
+    }
+};
+
+#endif // ACE128_linux_Arduino_h
@@ -0,0 +1,218 @@
+#ifndef ACE128_linux_Wire_h
+#define ACE128_linux_Wire_h
+/*
+  Wire.h - the Arduino Wire calls ACE128 makes, over a Linux /dev/i2c-N bus
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Every transaction is an I2C_RDWR ioctl, so it works on any adapter with plain I2C support. The bus speed is set
+  by the kernel driver, e.g. dtparam=i2c_arm_baudrate=400000 on a Raspberry Pi - setClock() can't change it.
+  Besides the Wire calls there is a batch interface: queue reads and writes for many chips and send them as one
+  ioctl with repeated STARTs between them. ACE128group uses it to read a whole panel with a single system call.
+
+  For testing without hardware define ACE128_I2C_OPEN and ACE128_I2C_IOCTL to your own functions with the same
+  arguments as open() and ioctl() and answer the I2C_RDWR requests from simulated chips. The i2c-stub kernel
+  module only does SMBus transfers, so it can't answer I2C_RDWR.
+*/
+
+#include "Arduino.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#ifndef ACE128_I2C_BUS
+  #define ACE128_I2C_BUS 1          // /dev/i2c-1 is the header bus on a Raspberry Pi
+#endif
+#ifndef ACE128_I2C_OPEN
+  #define ACE128_I2C_OPEN open
+#endif
+#ifndef ACE128_I2C_IOCTL
+  #define ACE128_I2C_IOCTL ioctl
+#endif
+
+#define BUFFER_LENGTH 32
+#define ACE128_WIRE_BATCH I2C_RDWR_IOCTL_MAX_MSGS  // messages in one batch - tells ACE128group batches are here
+#define ACE128_WIRE_BATCH_BYTES 64  // room for batched write data
+
+class TwoWire
+{
+  public:
+    TwoWire();
+    void setBus(int bus);          // use /dev/i2c-<bus>, call before begin()
+    void begin();
+    void setClock(uint32_t clock); // does nothing, see above
+    void beginTransmission(uint8_t addr);
+    void beginTransmission(int addr);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true); // 0 on success, 4 on any error
+    uint8_t requestFrom(int addr, int len);  // bytes read, 0 on error
+    int available();
+    int read();
+    // batches
+    void batchBegin();             // start an empty batch
+    uint8_t batchRoom();           // messages the batch can still take
+    boolean batchWrite(uint8_t addr, const uint8_t *data, uint8_t len); // queue a write, false if there's no room
+    boolean batchRead(uint8_t addr, uint8_t *dest, uint8_t len);        // queue a read into dest, false if there's no room
+    boolean batchEnd();            // send the batch, true if every message was acknowledged
+  private:
+    int _fd;                       // open /dev/i2c-N, -1 if not open
+    int _bus;                      // N
+    uint8_t _txAddr;               // address of the transmission being built
+    uint8_t _tx[BUFFER_LENGTH];    // transmission being built
+    uint8_t _txLen;
+    boolean _txPending;            // ended without a STOP - goes out with the next requestFrom()
+    uint8_t _rx[BUFFER_LENGTH];    // last requestFrom()
+    uint8_t _rxLen;
+    uint8_t _rxPos;
+    struct i2c_msg _batch[ACE128_WIRE_BATCH];
+    uint8_t _batchData[ACE128_WIRE_BATCH_BYTES]; // write data for the batch
+    uint8_t _batchMsgs;
+    uint8_t _batchBytes;
+    boolean _transfer(struct i2c_msg *msgs, uint8_t count);
+};
+
+TwoWire::TwoWire()
+{
+  _fd = -1;
+  _bus = ACE128_I2C_BUS;
+  _txAddr = 0;
+  _txLen = 0;
+  _txPending = false;
+  _rxLen = 0;
+  _rxPos = 0;
+  _batchMsgs = 0;
+  _batchBytes = 0;
+}
+
+void TwoWire::setBus(int bus)
+{
+  _bus = bus;
+}
+
+void TwoWire::begin()
+{
+  if (_fd >= 0) return;            // ACE128::begin() calls this once per encoder
+  char path[20];
+  snprintf(path, sizeof(path), "/dev/i2c-%d", _bus);
+  _fd = ACE128_I2C_OPEN(path, O_RDWR);
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+  (void)clock;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+  _txAddr = addr;
+  _txLen = 0;
+}
+
+void TwoWire::beginTransmission(int addr)
+{
+  beginTransmission((uint8_t)addr);
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (_txLen >= BUFFER_LENGTH) return (0);
+  _tx[_txLen++] = data;
+  return (1);
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  if (!sendStop)
+  {
+    _txPending = true;             // the kernel can only do the repeated START inside one ioctl
+    return (0);
+  }
+  struct i2c_msg msg = { _txAddr, 0, _txLen, _tx };
+  return (_transfer(&msg, 1) ? 0 : 4);
+}
+
+uint8_t TwoWire::requestFrom(int addr, int len)
+{
+  struct i2c_msg msgs[2];
+  uint8_t count = 0;
+  if (len > BUFFER_LENGTH) len = BUFFER_LENGTH;
+  if (_txPending)
+  {
+    _txPending = false;
+    struct i2c_msg msg = { _txAddr, 0, _txLen, _tx };
+    if (_txAddr == addr)
+    {
+      msgs[count++] = msg;         // write then read with a repeated START, like the AVR does
+    }
+    else
+    {
+      _transfer(&msg, 1);
+    }
+  }
+  struct i2c_msg msg = { (uint16_t)addr, I2C_M_RD, (uint16_t)len, _rx };
+  msgs[count++] = msg;
+  _rxPos = 0;
+  _rxLen = _transfer(msgs, count) ? len : 0;
+  return (_rxLen);
+}
+
+int TwoWire::available()
+{
+  return (_rxLen - _rxPos);
+}
+
+int TwoWire::read()
+{
+  return (_rxPos < _rxLen ? _rx[_rxPos++] : -1);
+}
+
+void TwoWire::batchBegin()
+{
+  _batchMsgs = 0;
+  _batchBytes = 0;
+}
+
+uint8_t TwoWire::batchRoom()
+{
+  return (ACE128_WIRE_BATCH - _batchMsgs);
+}
+
+boolean TwoWire::batchWrite(uint8_t addr, const uint8_t *data, uint8_t len)
+{
+  if (_batchMsgs >= ACE128_WIRE_BATCH || _batchBytes + len > ACE128_WIRE_BATCH_BYTES) return (false);
+  memcpy(_batchData + _batchBytes, data, len);
+  struct i2c_msg msg = { addr, 0, len, _batchData + _batchBytes };
+  _batch[_batchMsgs++] = msg;
+  _batchBytes += len;
+  return (true);
+}
+
+boolean TwoWire::batchRead(uint8_t addr, uint8_t *dest, uint8_t len)
+{
+  if (_batchMsgs >= ACE128_WIRE_BATCH) return (false);
+  struct i2c_msg msg = { addr, I2C_M_RD, len, dest };
+  _batch[_batchMsgs++] = msg;
+  return (true);
+}
+
+boolean TwoWire::batchEnd()
+{
+  boolean ok = (_batchMsgs == 0 || _transfer(_batch, _batchMsgs));
+  batchBegin();
+  return (ok);
+}
+
+boolean TwoWire::_transfer(struct i2c_msg *msgs, uint8_t count)
+{
+  struct i2c_rdwr_ioctl_data data = { msgs, count };
+  return (_fd >= 0 && ACE128_I2C_IOCTL(_fd, I2C_RDWR, &data) >= 0);
+}
+
+// ACE128 is a single header library built in one translation unit, and so is this
+TwoWire Wire;
+
+#endif // ACE128_linux_Wire_h
@@ -0,0 +1,124 @@
+/*
+  ace128replay.cpp - play an ACE128_TRACE recording back through the library on a desktop
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Build from the library directory, adding -DACE128_RECOVER if the recording encoder had it:
+    g++ -std=gnu++11 -O2 -I extras/linux -I src extras/linux/ace128replay.cpp -o ace128replay
+  Run with the map the knob was wired for and the trace file:
+    ./ace128replay [-v] [-n passes] 87654321 knob.trace
+  It prints the number of samples, invalid codes, jumps of more than a quarter turn between samples and the
+  final turn count, then the replay speed. -v prints every sample as: ms pins raw pos mpos.
+  -n replays the trace that many times over, for benchmarking the decode.
+*/
+
+#define ACE128_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ACE128.h>
+#include <ACE128trace.h>
+#include <ACE128map12345678.h>
+#include <ACE128map12348765.h>
+#include <ACE128map12348765R.h>
+#include <ACE128map18762345.h>
+#include <ACE128map54326781.h>
+#include <ACE128map56784321.h>
+#include <ACE128map87651234.h>
+#include <ACE128map87654321.h>
+
+static const struct
+{
+  const char *name;
+  const uint8_t *map;
+} maps[] = {
+  { "12345678", encoderMap_12345678 },
+  { "12348765", encoderMap_12348765 },
+  { "12348765R", encoderMap_12348765R },
+  { "18762345", encoderMap_18762345 },
+  { "54326781", encoderMap_54326781 },
+  { "56784321", encoderMap_56784321 },
+  { "87651234", encoderMap_87651234 },
+  { "87654321", encoderMap_87654321 },
+};
+
+static boolean verbose = false;
+static unsigned long invalid = 0;
+static unsigned long jumps = 0;
+static boolean first = true;
+static int16_t lastMpos = 0;
+
+static void onSample(const ACE128sample &s)
+{
+  if (verbose) printf("%lu %02X %u %d %d\n", s.ms, s.pins, s.raw, s.pos, s.mpos);
+  if (s.raw == 255) invalid++;
+  if (!first && abs(s.mpos - lastMpos) > 32) jumps++;
+  first = false;
+  lastMpos = s.mpos;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long passes = 1;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; arg++)
+  {
+    if (!strcmp(argv[arg], "-v")) verbose = true;
+    else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) passes = strtoul(argv[++arg], NULL, 10);
+    else break;
+  }
+  if (argc - arg != 2 || passes == 0)
+  {
+    fprintf(stderr, "usage: %s [-v] [-n passes] map trace\n", argv[0]);
+    return (2);
+  }
+  const uint8_t *map = NULL;
+  for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++)
+  {
+    if (!strcmp(argv[arg], maps[i].name)) map = maps[i].map;
+  }
+  if (map == NULL)
+  {
+    fprintf(stderr, "unknown map %s\n", argv[arg]);
+    return (2);
+  }
+  FILE *f = fopen(argv[arg + 1], "rb");
+  if (f == NULL)
+  {
+    perror(argv[arg + 1]);
+    return (1);
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *trace = (uint8_t *)malloc(len > 0 ? len : 1);
+  if (trace == NULL || fread(trace, 1, len, f) != (size_t)len)
+  {
+    fprintf(stderr, "can't read %s\n", argv[arg + 1]);
+    return (1);
+  }
+  fclose(f);
+
+  ACE128 knob(0x20, (uint8_t *)map); // never begin()'d, so the bus is never touched
+  unsigned long samples = 0;
+  unsigned long start = micros();
+  for (unsigned long pass = 0; pass < passes; pass++)
+  {
+    ACE128replay replay(knob, onSample);
+    first = true;
+    for (long i = 0; i < len; i++)
+    {
+      if (!replay.put(trace[i]))
+      {
+        fprintf(stderr, "bad trace at byte %ld\n", i);
+        return (1);
+      }
+    }
+    samples += replay.samples();
+    verbose = false;               // print the first pass only
+  }
+  unsigned long us = micros() - start;
+  printf("samples %lu invalid %lu jumps %lu mpos %d\n", samples / passes, invalid / passes, jumps / passes, lastMpos);
+  printf("%.1f ns per sample\n", us * 1000.0 / (samples ? samples : 1));
+  return (0);
+}
@@ -0,0 +1,672 @@
+#ifndef ACE128sim_h
+#define ACE128sim_h
+/*
+  ACE128sim.h - a simulated ACE-128, pin expanders and EEPROMs for building and testing ACE128 on a desktop
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  The Arduino.h, Wire.h and EEPROM.h next to this file run the library on top of these:
+    ACE128simShaft     a knob - set() or turn() it, and wire() its 8 pins in any order
+    ACE128simPCF8574   PCF8574 or PCF8574A reading a shaft, with its INT output
+    ACE128simMCP23008  MCP23008 reading a shaft, with its register file, register pointer, SEQOP and INT output
+    ACE128simMCP23017, ACE128simPCA9555, ACE128simPCF8575   16 bit expanders reading a shaft on each port
+    ACE128simEEPROM    24xx I2C EEPROM with 16 bit addresses and page writes
+    ACE128simTCA9548A  TCA9548A multiplexer, with devices attached behind its channels
+    ACE128simTWI       the AVR TWI registers on the same bus, for ACE128_ASYNC
+    ACE128sim          the rest of the world - the bus, the clock, the AVR EEPROM, direct wired pins and counters
+  Time only moves when the bus is busy or the caller advance()s it, so every run is the same.
+  The track is the datasheet's, copied here rather than taken from the library so the two check each other.
+  Like the library this goes into one translation unit, so the globals are defined here.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class ACE128simShaft;
+void ACE128sim_changed();          // a shaft moved - refresh anything that samples it
+
+// the knob
+class ACE128simShaft
+{
+  public:
+    ACE128simShaft()
+    {
+      static const uint8_t authors[8] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+      _raw = 0;
+      _noise = 0;
+      wire(authors);
+    }
+    void wire(const uint8_t *order)  // ACE-128 pin on each of P0 - P7, as in the map names
+    {
+      memcpy(_order, order, 8);
+      _changed();
+    }
+    void set(uint8_t raw)          // raw position 0 - 127
+    {
+      _raw = raw & 0x7F;
+      _changed();
+    }
+    void turn(int16_t steps)       // positive is rising raw position
+    {
+      _raw = (_raw + steps) & 0x7F;
+      _changed();
+    }
+    void noise(uint8_t mask)       // flip these pins on every read until noise(0), e.g. a dirty contact
+    {
+      _noise = mask;
+      _changed();
+    }
+    uint8_t raw() const
+    {
+      return (_raw);
+    }
+    uint8_t pins() const           // P0 - P7 now
+    {
+      return (_pins);
+    }
+    // the pin code at raw position raw for a wiring - each ACE-128 pin reads the track 16 positions behind the last
+    static uint8_t code(uint8_t raw, const uint8_t *order)
+    {
+      static const uint8_t track[16] = { 0xC0, 0x3F, 0xF0, 0x0F, 0xE0, 0x1F, 0xFF, 0xFF,
+                                         0xFF, 0x00, 0xFC, 0x03, 0x80, 0x78, 0x06, 0x01 };
+      uint8_t pins = 0;
+      for (uint8_t i = 0; i < 8; i++)
+      {
+        uint8_t at = (raw + (order[i] - 1) * 16) & 0x7F;
+        if (track[at / 8] & (0x80 >> (raw % 8))) pins |= 1 << i;
+      }
+      return (pins);
+    }
+  private:
+    uint8_t _order[8];
+    uint8_t _raw;
+    uint8_t _noise;
+    uint8_t _pins;                 // pins() at _raw
+    void _changed()
+    {
+      _pins = code(_raw, _order) ^ _noise;
+      ACE128sim_changed();
+    }
+};
+
+// anything on the bus. A transaction that returns false NACKs its address
+class ACE128simDevice
+{
+  public:
+    virtual ~ACE128simDevice() {}
+    virtual bool write(const uint8_t *data, uint8_t len) = 0;
+    virtual bool read(uint8_t *data, uint8_t len) = 0;
+    virtual bool interrupt()       // INT output asserted, pulling its pin low
+    {
+      return (false);
+    }
+    virtual void watch() {}        // a shaft moved - latch what INT has to report
+};
+
+// TCA9548A I2C multiplexer. The control byte written opens a channel per bit, and the bus reaches the devices
+// attached to open channels as well as the main bus
+class ACE128simTCA9548A : public ACE128simDevice
+{
+  public:
+    uint8_t open;                  // control register
+    unsigned long writes;          // control register writes
+    ACE128simTCA9548A() : open(0), writes(0) {}
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      if (len > 0)
+      {
+        open = data[len - 1];
+        writes++;
+      }
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) data[i] = open;
+      return (true);
+    }
+};
+
+// everything that isn't a device of its own
+class ACE128simWorld
+{
+  public:
+    // counters, cleared by reset()
+    unsigned long transactions;    // addressed bus transfers, reads and writes
+    unsigned long busBytes;        // data bytes moved on the bus
+    unsigned long nacks;           // transfers nobody acknowledged
+    unsigned long eepromWrites;    // AVR EEPROM bytes written
+    unsigned long pgmReads;        // pgm_read_byte() calls - map table reads
+    unsigned long digitalReads;    // digitalRead() calls
+    unsigned long wireBegins;      // Wire.begin() calls
+    // state
+    unsigned long us;              // the clock
+    uint32_t clock;                // bus clock for timing transfers, set by Wire.setClock()
+    uint8_t eeprom[1024];          // AVR EEPROM, blank to start with
+    uint8_t pinReg[8];             // AVR PINx registers, see Arduino.h
+
+    ACE128simWorld()
+    {
+      us = 0;
+      clock = 100000;
+      memset(eeprom, 0xFF, sizeof(eeprom));
+      memset(_device, 0, sizeof(_device));
+      memset(_channel, 0, sizeof(_channel));
+      _mux = NULL;
+      memset(_pinShaft, 0, sizeof(_pinShaft));
+      memset(_pinInt, 0, sizeof(_pinInt));
+      memset(pinReg, 0, sizeof(pinReg));
+      reset();
+    }
+    void reset()
+    {
+      transactions = 0;
+      busBytes = 0;
+      nacks = 0;
+      eepromWrites = 0;
+      pgmReads = 0;
+      digitalReads = 0;
+      wireBegins = 0;
+    }
+    void advance(unsigned long dt) // let time pass
+    {
+      us += dt;
+    }
+    // the bus
+    void attach(uint8_t addr, ACE128simDevice &device)
+    {
+      _device[addr & 0x7F] = &device;
+    }
+    void attach(uint8_t addr, ACE128simTCA9548A &mux)  // the multiplexer - devices can go on its channels too
+    {
+      _device[addr & 0x7F] = &mux;
+      _mux = &mux;
+    }
+    void attach(uint8_t addr, ACE128simDevice &device, uint8_t channel)  // behind the multiplexer
+    {
+      _channel[channel & 7][addr & 0x7F] = &device;
+    }
+    void detach(uint8_t addr)
+    {
+      _device[addr & 0x7F] = NULL;
+    }
+    bool present(uint8_t addr)     // something answers at addr
+    {
+      return (_route(addr) != NULL);
+    }
+    bool write(uint8_t addr, const uint8_t *data, uint8_t len)
+    {
+      ACE128simDevice *device = _route(addr);
+      bool ack = (device != NULL && device->write(data, len));
+      _transfer(ack, len);
+      return (ack);
+    }
+    bool read(uint8_t addr, uint8_t *data, uint8_t len)
+    {
+      ACE128simDevice *device = _route(addr);
+      bool ack = (device != NULL && device->read(data, len));
+      if (!ack) memset(data, 0xFF, len);  // nobody pulls SDA down
+      _transfer(ack, len);
+      return (ack);
+    }
+    // direct wired pins - Arduino pin n reads P<bit> of a shaft. Unconnected pins read HIGH, as pulled up
+    void connect(uint8_t pin, ACE128simShaft &shaft, uint8_t bit)
+    {
+      _pinShaft[pin] = &shaft;
+      _pinBit[pin] = bit;
+      changed();
+    }
+    void connect(const uint8_t *pins, ACE128simShaft &shaft)  // P0 - P7 on these 8 pins
+    {
+      for (uint8_t i = 0; i < 8; i++) connect(pins[i], shaft, i);
+    }
+    // device INT outputs - open drain, so up to 4 can share a pin, which reads LOW while any of them is asserted
+    bool connectInt(uint8_t pin, ACE128simDevice &device)
+    {
+      for (uint8_t i = 0; i < 4; i++)
+      {
+        if (_pinInt[pin][i] != NULL) continue;
+        _pinInt[pin][i] = &device;
+        changed();
+        return (true);
+      }
+      return (false);
+    }
+    int pinLevel(uint8_t pin)
+    {
+      if (pin >= 64) return (1);
+      for (uint8_t i = 0; i < 4 && _pinInt[pin][i] != NULL; i++)
+      {
+        if (_pinInt[pin][i]->interrupt()) return (0);
+      }
+      if (_pinShaft[pin] == NULL) return (1);
+      return ((_pinShaft[pin]->pins() >> _pinBit[pin]) & 1);
+    }
+    // Arduino Uno pin to port: D0 - D7 PORTD, D8 - D13 PORTB, A0 - A5 (14 - 19) PORTC. 0 is NOT_A_PIN
+    static uint8_t port(uint8_t pin)
+    {
+      return (pin < 8 ? 4 : pin < 14 ? 2 : pin < 20 ? 3 : 0);
+    }
+    static uint8_t bitMask(uint8_t pin)
+    {
+      return (1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14));
+    }
+    void changed()                 // let the INT outputs see the move, refresh the PINx registers
+    {
+      for (uint8_t pin = 0; pin < 64; pin++)
+      {
+        for (uint8_t i = 0; i < 4 && _pinInt[pin][i] != NULL; i++) _pinInt[pin][i]->watch();
+      }
+      memset(pinReg, 0, sizeof(pinReg));
+      for (uint8_t pin = 0; pin < 20; pin++)
+      {
+        if (pinLevel(pin)) pinReg[port(pin)] |= bitMask(pin);
+      }
+    }
+  private:
+    ACE128simDevice *_device[128];
+    ACE128simDevice *_channel[8][128];
+    ACE128simTCA9548A *_mux;
+    ACE128simShaft *_pinShaft[64];
+    uint8_t _pinBit[64];
+    ACE128simDevice *_pinInt[64][4];
+    ACE128simDevice *_route(uint8_t addr)
+    {
+      addr &= 0x7F;
+      if (_device[addr] != NULL || _mux == NULL) return (_device[addr]);
+      for (uint8_t channel = 0; channel < 8; channel++)
+      {
+        if ((_mux->open & (1 << channel)) && _channel[channel][addr] != NULL) return (_channel[channel][addr]);
+      }
+      return (NULL);
+    }
+    // START, address and data at 9 clocks a byte, then STOP
+    void _transfer(bool ack, uint8_t len)
+    {
+      transactions++;
+      if (!ack) nacks++;
+      busBytes += len;
+      us += (unsigned long)(len + 1) * 9 * 1000000UL / clock + 10;
+    }
+};
+
+ACE128simWorld ACE128sim;
+
+void ACE128sim_changed()
+{
+  ACE128sim.changed();
+}
+
+// The ATmega328P TWI peripheral, as far as ACE128_ASYNC drives it by hand, on the same bus. Each START, address,
+// data byte or STOP completes on the second read of TWCR after it was asked for. Written bytes go to the device as
+// one write at the next START or STOP. A read fetches a byte from the device as each one is asked for
+class ACE128simTWI
+{
+  public:
+    enum { TWIE = 0, TWEN = 2, TWSTO = 4, TWSTA = 5, TWEA = 6, TWINT = 7 };
+    uint8_t dr;                    // TWDR
+    uint8_t sr;                    // TWSR
+    unsigned long steps;           // bus steps asked for
+    ACE128simTWI() : dr(0xFF), sr(0xF8), steps(0), _cr(0), _busy(0), _phase(IDLE), _addr(0), _len(0) {}
+    uint8_t cr()                   // read TWCR
+    {
+      if (_busy && --_busy == 0)
+      {
+        if (_cr & (1 << TWSTO)) _cr &= ~(1 << TWSTO);
+        else _cr |= 1 << TWINT;
+      }
+      return (_cr);
+    }
+    void cr(uint8_t v)             // write TWCR - a 1 in TWINT clears it and starts the next step
+    {
+      _cr = v & ~(1 << TWINT);
+      if (!(v & (1 << TWINT))) return;
+      steps++;
+      _busy = 2;
+      if (v & (1 << TWSTO))
+      {
+        _flush();
+        _phase = IDLE;
+        sr = 0xF8;
+        return;
+      }
+      if (v & (1 << TWSTA))
+      {
+        _flush();
+        sr = (_phase == IDLE) ? 0x08 : 0x10;  // START, repeated START
+        _phase = ADDRESS;
+        return;
+      }
+      switch (_phase)
+      {
+        case ADDRESS:
+          _addr = dr >> 1;
+          _len = 0;
+          if (!ACE128sim.present(_addr))
+          {
+            ACE128sim.write(_addr, NULL, 0);  // counts the NACK
+            sr = (dr & 1) ? 0x48 : 0x20;
+            _phase = NACKED;
+          }
+          else
+          {
+            sr = (dr & 1) ? 0x40 : 0x18;
+            _phase = (dr & 1) ? READING : WRITING;
+          }
+          break;
+        case WRITING:
+          if (_len < sizeof(_buf)) _buf[_len++] = dr;
+          sr = 0x28;
+          break;
+        case READING:
+          ACE128sim.read(_addr, &dr, 1);
+          sr = (v & (1 << TWEA)) ? 0x50 : 0x58;
+          break;
+        default:
+          sr = 0x00;               // bus error
+      }
+    }
+  private:
+    enum { IDLE, ADDRESS, WRITING, READING, NACKED };
+    uint8_t _cr;
+    uint8_t _busy;                 // TWCR reads until the step completes
+    uint8_t _phase;
+    uint8_t _addr;
+    uint8_t _buf[32];
+    uint8_t _len;
+    void _flush()
+    {
+      if (_phase == WRITING) ACE128sim.write(_addr, _buf, _len);
+      _phase = IDLE;
+    }
+};
+
+ACE128simTWI ACE128simTwi;
+
+// PCF8574 or PCF8574A. The pins are quasi-bidirectional - a pin written low reads low. INT is asserted while the
+// pins differ from what they were at the last read or write, so moving back also releases it
+class ACE128simPCF8574 : public ACE128simDevice
+{
+  public:
+    ACE128simPCF8574(ACE128simShaft &shaft) : _shaft(shaft), _latch(0xFF)
+    {
+      _seen = _port();
+    }
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      if (len > 0) _latch = data[len - 1];
+      _seen = _port();
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) data[i] = _port();
+      _seen = _port();
+      return (true);
+    }
+    bool interrupt()
+    {
+      return (_port() != _seen);
+    }
+  private:
+    ACE128simShaft &_shaft;
+    uint8_t _latch;
+    uint8_t _seen;                 // the pins at the last read or write
+    uint8_t _port()
+    {
+      return (_shaft.pins() & _latch);
+    }
+};
+
+// MCP23008. The first byte written sets the register pointer and the rest go to registers from there. The pointer
+// moves on after each byte, wrapping after OLAT, unless IOCON.SEQOP is set. A change on a GPINTEN pin, against the
+// previous level or against DEFVAL where INTCON is set, sets INTF and captures GPIO in INTCAP. INT is asserted while
+// INTF is set - reading GPIO or INTCAP clears it, unless a pin still differs from DEFVAL. It is taken as open drain,
+// active low, which is how ACE128 sets it up
+class ACE128simMCP23008 : public ACE128simDevice
+{
+  public:
+    enum { IODIR, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU, INTF, INTCAP, GPIO, OLAT };
+    uint8_t reg[11];
+    uint8_t ptr;
+    ACE128simMCP23008(ACE128simShaft &shaft) : _shaft(shaft)
+    {
+      memset(reg, 0, sizeof(reg));
+      reg[IODIR] = 0xFF;           // power on state
+      ptr = 0;
+      _prev = _shaft.pins();
+    }
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      if (len == 0) return (true);
+      ptr = data[0] % 11;
+      for (uint8_t i = 1; i < len; i++)
+      {
+        if (ptr != GPIO && ptr != INTF && ptr != INTCAP) reg[ptr] = data[i];
+        _next();
+      }
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++)
+      {
+        data[i] = (ptr == GPIO) ? _gpio() : reg[ptr];
+        if (ptr == GPIO || ptr == INTCAP)
+        {
+          reg[INTF] = 0;
+          watch();                 // a pin still off DEFVAL asserts it again
+        }
+        _next();
+      }
+      return (true);
+    }
+    bool interrupt()
+    {
+      return (reg[INTF] != 0);
+    }
+    void watch()
+    {
+      uint8_t pins = _shaft.pins();
+      uint8_t hit = reg[GPINTEN] & ((reg[INTCON] & (pins ^ reg[DEFVAL])) | (~reg[INTCON] & (pins ^ _prev)));
+      if (hit != 0 && reg[INTF] == 0) reg[INTCAP] = _gpio();
+      reg[INTF] |= hit;
+      _prev = pins;
+    }
+  private:
+    ACE128simShaft &_shaft;
+    uint8_t _prev;                 // the pins when last watched
+    uint8_t _gpio()
+    {
+      return (((_shaft.pins() ^ reg[IPOL]) & reg[IODIR]) | (reg[OLAT] & ~reg[IODIR]));
+    }
+    void _next()
+    {
+      if (!(reg[IOCON] & 0x20)) ptr = (ptr + 1) % 11;
+    }
+};
+
+// MCP23017 with IOCON.BANK = 0, so the A and B registers alternate. The pointer moves on after each byte, wrapping
+// after OLATB, unless IOCON.SEQOP is set, when it toggles between the A and B register of a pair. IOCON is at both
+// 0x0A and 0x0B
+class ACE128simMCP23017 : public ACE128simDevice
+{
+  public:
+    enum { IODIRA, IODIRB, IPOLA, IPOLB, GPINTENA, GPINTENB, DEFVALA, DEFVALB, INTCONA, INTCONB, IOCON, IOCON2,
+           GPPUA, GPPUB, INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB, OLATA, OLATB };
+    uint8_t reg[22];
+    uint8_t ptr;
+    ACE128simMCP23017(ACE128simShaft &a, ACE128simShaft &b) : _a(a), _b(b)
+    {
+      memset(reg, 0, sizeof(reg));
+      reg[IODIRA] = 0xFF;          // power on state
+      reg[IODIRB] = 0xFF;
+      ptr = 0;
+    }
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      if (len == 0) return (true);
+      ptr = data[0] % 22;
+      for (uint8_t i = 1; i < len; i++)
+      {
+        if (ptr == IOCON || ptr == IOCON2) reg[IOCON] = reg[IOCON2] = data[i];
+        else if (ptr < INTFA || ptr > GPIOB) reg[ptr] = data[i];
+        _next();
+      }
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++)
+      {
+        if (ptr == GPIOA || ptr == GPIOB)
+        {
+          uint8_t b = ptr & 1;
+          uint8_t pins = b ? _b.pins() : _a.pins();
+          data[i] = ((pins ^ reg[IPOLA + b]) & reg[IODIRA + b]) | (reg[OLATA + b] & ~reg[IODIRA + b]);
+        }
+        else
+        {
+          data[i] = reg[ptr];
+        }
+        _next();
+      }
+      return (true);
+    }
+  private:
+    ACE128simShaft &_a;
+    ACE128simShaft &_b;
+    void _next()
+    {
+      ptr = (reg[IOCON] & 0x20) ? ptr ^ 1 : (ptr + 1) % 22;
+    }
+};
+
+// PCA9555. The command byte picks a register, and the bytes after it toggle between that register and its pair
+class ACE128simPCA9555 : public ACE128simDevice
+{
+  public:
+    enum { INPUT0, INPUT1, OUTPUT0, OUTPUT1, POLARITY0, POLARITY1, CONFIG0, CONFIG1 };
+    uint8_t reg[8];
+    uint8_t ptr;
+    ACE128simPCA9555(ACE128simShaft &a, ACE128simShaft &b) : _a(a), _b(b)
+    {
+      memset(reg, 0, sizeof(reg));
+      reg[OUTPUT0] = reg[OUTPUT1] = 0xFF;  // power on state
+      reg[CONFIG0] = reg[CONFIG1] = 0xFF;
+      ptr = 0;
+    }
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      if (len == 0) return (true);
+      ptr = data[0] & 7;
+      for (uint8_t i = 1; i < len; i++)
+      {
+        if (ptr > INPUT1) reg[ptr] = data[i];
+        ptr ^= 1;
+      }
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++)
+      {
+        if (ptr <= INPUT1)
+        {
+          uint8_t pins = ptr ? _b.pins() : _a.pins();
+          data[i] = ((pins ^ reg[POLARITY0 + ptr]) & reg[CONFIG0 + ptr]) | (reg[OUTPUT0 + ptr] & ~reg[CONFIG0 + ptr]);
+        }
+        else
+        {
+          data[i] = reg[ptr];
+        }
+        ptr ^= 1;
+      }
+      return (true);
+    }
+  private:
+    ACE128simShaft &_a;
+    ACE128simShaft &_b;
+};
+
+// PCF8575. Like the PCF8574, with bytes alternating between P00 - P07 and P10 - P17
+class ACE128simPCF8575 : public ACE128simDevice
+{
+  public:
+    ACE128simPCF8575(ACE128simShaft &a, ACE128simShaft &b) : _a(a), _b(b)
+    {
+      _latch[0] = _latch[1] = 0xFF;
+    }
+    bool write(const uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) _latch[i & 1] = data[i];
+      return (true);
+    }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) data[i] = ((i & 1) ? _b.pins() : _a.pins()) & _latch[i & 1];
+      return (true);
+    }
+  private:
+    ACE128simShaft &_a;
+    ACE128simShaft &_b;
+    uint8_t _latch[2];
+};
+
+// 24xx I2C EEPROM with 16 bit addresses. A write of 2 bytes sets the address, and more than that writes
+// the rest of the bytes within the page, wrapping at the page end like the real chip. Set writeCycle to
+// have it NACK everything for that many us after a write, as a real one does
+class ACE128simEEPROM : public ACE128simDevice
+{
+  public:
+    uint8_t data[4096];
+    unsigned long writes;          // write cycles - page writes
+    unsigned long writeCycle;      // us a write keeps it busy, 0 to never be busy
+    ACE128simEEPROM(uint8_t page = 32) : writes(0), writeCycle(0), _page(page), _addr(0), _busyUntil(0)
+    {
+      memset(data, 0xFF, sizeof(data));
+    }
+    bool write(const uint8_t *bytes, uint8_t len)
+    {
+      if (_busy()) return (false);
+      if (len < 2) return (true);  // ack polling
+      _addr = ((bytes[0] << 8) | bytes[1]) % sizeof(data);
+      if (len == 2) return (true);
+      for (uint8_t i = 2; i < len; i++)
+      {
+        uint16_t page = _addr - _addr % _page;
+        data[page + (_addr % _page + i - 2) % _page] = bytes[i];
+      }
+      writes++;
+      _busyUntil = ACE128sim.us + writeCycle;
+      return (true);
+    }
+    bool read(uint8_t *bytes, uint8_t len)
+    {
+      if (_busy()) return (false);
+      for (uint8_t i = 0; i < len; i++)
+      {
+        bytes[i] = data[_addr];
+        _addr = (_addr + 1) % sizeof(data);
+      }
+      return (true);
+    }
+  private:
+    uint8_t _page;
+    uint16_t _addr;
+    unsigned long _busyUntil;
+    bool _busy()
+    {
+      return (writeCycle > 0 && (long)(_busyUntil - ACE128sim.us) > 0);
+    }
+};
+
+// test checks - count failures and say where they were, then return main()'s exit code from ACE128SIM_DONE()
+int ACE128sim_failures = 0;
+#define ACE128SIM_CHECK(cond) \
+  do { if (!(cond)) { ACE128sim_failures++; printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+#define ACE128SIM_DONE() \
+  (printf("%s: %s\n", __FILE__, ACE128sim_failures ? "FAILED" : "ok"), ACE128sim_failures ? 1 : 0)
+
+#endif // ACE128sim_h
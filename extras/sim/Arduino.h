@@ -0,0 +1,137 @@
+#ifndef ACE128_sim_Arduino_h
+#define ACE128_sim_Arduino_h
+/*
+  Arduino.h - the Arduino core on top of ACE128sim.h, for testing ACE128 on a desktop
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Time is ACE128sim.us. digitalRead() reads whatever ACE128sim.connect() or connectInt() put on the pin. With ARDUINO_ARCH_AVR
+  defined the pins are on Uno ports too, so ACE128_FAST_PINS reads the PINx registers. With ACE128SIM_TWI defined
+  the AVR TWI registers are there, so ACE128_ASYNC drives the bus by hand. pgm_read_byte() counts into
+  ACE128sim.pgmReads. See CMakeLists.txt for building the tests and benchmarks.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ACE128sim.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define DEC 10
+#define HEX 16
+
+// the maps are plain const arrays here
+#define PROGMEM
+inline uint8_t ACE128sim_pgm(const void *addr)
+{
+  ACE128sim.pgmReads++;
+  return (*(const uint8_t *)addr);
+}
+#define pgm_read_byte(addr) ACE128sim_pgm(addr)
+
+inline unsigned long micros()
+{
+  return (ACE128sim.us);
+}
+
+inline unsigned long millis()
+{
+  return (ACE128sim.us / 1000);
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+  ACE128sim.advance(us);
+}
+
+inline void delay(unsigned long ms)
+{
+  ACE128sim.advance(ms * 1000);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+  ACE128sim.digitalReads++;
+  return (ACE128sim.pinLevel(pin));
+}
+
+#ifdef ARDUINO_ARCH_AVR
+// enough of the AVR core for ACE128_FAST_PINS
+#define NOT_A_PIN 0
+#define digitalPinToPort(pin) ACE128simWorld::port(pin)
+#define digitalPinToBitMask(pin) ACE128simWorld::bitMask(pin)
+#define portInputRegister(port) ((volatile uint8_t *)&ACE128sim.pinReg[port])
+uint8_t SREG = 0x80;
+inline void cli()
+{
+  SREG &= 0x7F;
+}
+inline void sei()
+{
+  SREG |= 0x80;
+}
+#endif
+
+#ifdef ACE128SIM_TWI
+// the AVR TWI registers, on ACE128simTwi - enough for ACE128_ASYNC to drive the bus by hand
+#define _BV(bit) (1 << (bit))
+#define TWIE  ACE128simTWI::TWIE
+#define TWEN  ACE128simTWI::TWEN
+#define TWSTO ACE128simTWI::TWSTO
+#define TWSTA ACE128simTWI::TWSTA
+#define TWEA  ACE128simTWI::TWEA
+#define TWINT ACE128simTWI::TWINT
+struct ACE128simTWCR
+{
+  operator uint8_t() { return (ACE128simTwi.cr()); }
+  ACE128simTWCR &operator=(uint8_t v) { ACE128simTwi.cr(v); return (*this); }
+};
+struct ACE128simTWDR
+{
+  operator uint8_t() { return (ACE128simTwi.dr); }
+  ACE128simTWDR &operator=(uint8_t v) { ACE128simTwi.dr = v; return (*this); }
+};
+struct ACE128simTWSR
+{
+  operator uint8_t() { return (ACE128simTwi.sr); }
+};
+ACE128simTWCR TWCR;
+ACE128simTWDR TWDR;
+ACE128simTWSR TWSR;
+#define TWCR TWCR                  // the core's registers are macros, and ACE128.h checks for TWCR
+#define TWDR TWDR
+#define TWSR TWSR
+#endif
+
+// a single threaded program has nothing to hold off
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// enough of Print for ACE128_TRACE
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+      size_t n = 0;
+      while (len--) n += write(*buf++);
+      return (n);
+    }
+};
+
+#endif // ACE128_sim_Arduino_h
@@ -0,0 +1,47 @@
+#ifndef ACE128_sim_EEPROM_h
+#define ACE128_sim_EEPROM_h
+/*
+  EEPROM.h - the Arduino AVR EEPROM library on ACE128sim.eeprom, counting byte writes in ACE128sim.eepromWrites
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+    uint8_t read(int idx)
+    {
+      return (ACE128sim.eeprom[idx % sizeof(ACE128sim.eeprom)]);
+    }
+    void write(int idx, uint8_t val)
+    {
+      ACE128sim.eeprom[idx % sizeof(ACE128sim.eeprom)] = val;
+      ACE128sim.eepromWrites++;
+    }
+    void update(int idx, uint8_t val)  // writes only if the byte differs
+    {
+      if (read(idx) != val) write(idx, val);
+    }
+    uint16_t length()
+    {
+      return (sizeof(ACE128sim.eeprom));
+    }
+    template <typename T> T &get(int idx, T &t)
+    {
+      uint8_t *p = (uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) p[i] = read(idx + i);
+      return (t);
+    }
+    template <typename T> const T &put(int idx, const T &t)
+    {
+      const uint8_t *p = (const uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) update(idx + i, p[i]);
+      return (t);
+    }
+};
+
+EEPROMClass EEPROM;
+
+#endif // ACE128_sim_EEPROM_h
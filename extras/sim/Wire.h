@@ -0,0 +1,74 @@
+#ifndef ACE128_sim_Wire_h
+#define ACE128_sim_Wire_h
+/*
+  Wire.h - the Arduino Wire calls ACE128 makes, on the ACE128sim.h bus
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Each endTransmission() and requestFrom() is one bus transaction, counted in ACE128sim.transactions and timed at
+  the setClock() rate. The buffer is 32 bytes, as on AVR.
+*/
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire
+{
+  public:
+    TwoWire() : _txAddr(0), _txLen(0), _rxLen(0), _rxPos(0) {}
+    void begin()
+    {
+      ACE128sim.wireBegins++;
+    }
+    void setClock(uint32_t clock)
+    {
+      ACE128sim.clock = clock;
+    }
+    void beginTransmission(uint8_t addr)
+    {
+      _txAddr = addr;
+      _txLen = 0;
+    }
+    void beginTransmission(int addr)
+    {
+      beginTransmission((uint8_t)addr);
+    }
+    size_t write(uint8_t data)
+    {
+      if (_txLen >= BUFFER_LENGTH) return (0);
+      _tx[_txLen++] = data;
+      return (1);
+    }
+    uint8_t endTransmission(bool sendStop = true)  // 0 on success, 2 on an address NACK
+    {
+      (void)sendStop;
+      return (ACE128sim.write(_txAddr, _tx, _txLen) ? 0 : 2);
+    }
+    uint8_t requestFrom(int addr, int len)         // bytes read, 0 on a NACK
+    {
+      if (len > BUFFER_LENGTH) len = BUFFER_LENGTH;
+      _rxPos = 0;
+      _rxLen = ACE128sim.read((uint8_t)addr, _rx, (uint8_t)len) ? len : 0;
+      return (_rxLen);
+    }
+    int available()
+    {
+      return (_rxLen - _rxPos);
+    }
+    int read()
+    {
+      return (_rxPos < _rxLen ? _rx[_rxPos++] : -1);
+    }
+  private:
+    uint8_t _txAddr;
+    uint8_t _tx[BUFFER_LENGTH];
+    uint8_t _txLen;
+    uint8_t _rx[BUFFER_LENGTH];
+    uint8_t _rxLen;
+    uint8_t _rxPos;
+};
+
+TwoWire Wire;
+
+#endif // ACE128_sim_Wire_h
@@ -0,0 +1,121 @@
+/*
+  bench.cpp - desktop figures for one configuration, a row of the table "cmake --build . --target bench" prints
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Columns:
+    acePins  host ns for acePins() - the simulated read alone
+    decode   host ns rawPos() takes on top of that - the map lookup
+    mpos     host ns for a whole mpos()
+    tx/upos, tx/mpos, tx/sample   bus transactions per call, as the real bus would see them
+    ee/rev   EEPROM writes per revolution turning 8 turns each way then resting 5s - bytes on AVR, page writes on I2C
+  Host times say how the configurations compare, not how fast an AVR is - extras/avrbench does that.
+*/
+
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+#include <ACE128map.h>
+#include <chrono>
+
+#ifdef ACE128_COMPACT_MAP
+  #define MAP ((uint8_t *)ACE128map<8, 7, 6, 5, 4, 3, 2, 1>::order)
+#else
+  #define MAP ((uint8_t *)encoderMap_87654321)
+#endif
+
+ACE128simShaft shaft;
+ACE128simEEPROM i2cEeprom;
+#ifdef ACE128_ARDUINO_PINS
+const uint8_t knobPins[8] = { 2, 3, 4, 5, 6, 7, 8, 9 };
+  #ifdef ACE128_EEPROM_NONE
+ACE128 knob(2, 3, 4, 5, 6, 7, 8, 9, MAP);
+  #else
+ACE128 knob(2, 3, 4, 5, 6, 7, 8, 9, MAP, 0);
+  #endif
+#else
+  #ifdef ACE128_MCP23008
+ACE128simMCP23008 chip(shaft);
+    #define ADDR 0x01            // MCP23008 at 0x21
+  #else
+ACE128simPCF8574 chip(shaft);
+    #define ADDR 0x21
+  #endif
+  #ifdef ACE128_EEPROM_NONE
+ACE128 knob(ADDR, MAP);
+  #else
+ACE128 knob(ADDR, MAP, 0);
+  #endif
+#endif
+
+volatile int32_t sink;
+const long N = 200000;
+
+// host ns per call of f, the best of 5 runs
+template <typename F> double ns(F f)
+{
+  double best = 1e9;
+  for (int run = 0; run < 5; run++)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < N; i++)
+    {
+      if (!(i & 63)) shaft.turn(1);
+      sink = f();
+    }
+    double t = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N;
+    if (t < best) best = t;
+  }
+  return (best);
+}
+
+// bus transactions per call of f
+template <typename F> double tx(F f)
+{
+  ACE128sim.reset();
+  for (int i = 0; i < 1000; i++)
+  {
+    shaft.turn(1);
+    sink = f();
+  }
+  return (ACE128sim.transactions / 1000.0);
+}
+
+double eepromPerRev()
+{
+  unsigned long start = ACE128sim.eepromWrites + i2cEeprom.writes;
+  for (int dir = 1; dir >= -1; dir -= 2)
+  {
+    for (int i = 0; i < 8 * 128; i++)
+    {
+      shaft.turn(dir);
+      knob.mpos();
+      ACE128sim.advance(2000);
+    }
+  }
+  for (int i = 0; i < 500; i++)
+  {
+    knob.mpos();
+    ACE128sim.advance(10000);
+  }
+  return ((ACE128sim.eepromWrites + i2cEeprom.writes - start) / 16.0);
+}
+
+int main()
+{
+#ifdef ACE128_ARDUINO_PINS
+  ACE128sim.connect(knobPins, shaft);
+#else
+  ACE128sim.attach(0x21, chip);
+#endif
+  ACE128sim.attach(0x50, i2cEeprom);
+  knob.begin();
+  double pins = ns([] { return (knob.acePins()); });
+  double raw = ns([] { return (knob.rawPos()); });
+  double mpos = ns([] { return (knob.mpos()); });
+  double txUpos = tx([] { return (knob.upos()); });
+  double txMpos = tx([] { return (knob.mpos()); });
+  double txSample = tx([] { return (knob.sample().mpos); });
+  printf("%-14s %8.1f %8.1f %8.1f %8.2f %8.2f %9.2f %8.2f\n", ACE128SIM_CONFIG, pins, raw - pins, mpos,
+         txUpos, txMpos, txSample, eepromPerRev());
+  return (0);
+}
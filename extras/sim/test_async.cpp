@@ -0,0 +1,65 @@
+/*
+  test_async.cpp - split reads on the simulated TWI hardware, several encoders at once
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128SIM_TWI
+#define ACE128_ASYNC
+#define ACE128_MCP23008
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+ACE128simShaft shafts[3];
+ACE128simPCF8574 pcf(shafts[0]);
+ACE128simMCP23008 mcp(shafts[1]);
+ACE128simPCF8574 pcfA(shafts[2]);
+ACE128 knobs[4] = { ACE128(0x20, (uint8_t *)encoderMap_87654321), ACE128(0x01, (uint8_t *)encoderMap_87654321),
+                    ACE128(0x38, (uint8_t *)encoderMap_87654321), ACE128(0x22, (uint8_t *)encoderMap_87654321) };
+
+// start every read at once, then poll them all round until they are all done
+void readAll(uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++) knobs[i].startRead();
+  for (int spins = 0; spins < 10000; spins++)
+  {
+    boolean done = true;
+    for (uint8_t i = 0; i < count; i++) done &= knobs[i].poll();
+    if (done) return;
+  }
+  ACE128SIM_CHECK(!"reads never finished");
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, pcf);
+  ACE128sim.attach(0x21, mcp);
+  ACE128sim.attach(0x38, pcfA);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    shafts[i].set(i * 40);
+    knobs[i].begin();
+  }
+  // each read has the bus to itself, in turn - one transaction each, as begin() parked the MCP23008 pointer
+  ACE128sim.reset();
+  for (int step = 0; step < 300; step++)
+  {
+    for (uint8_t i = 0; i < 3; i++) shafts[i].turn(i + 1);
+    readAll(3);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      ACE128SIM_CHECK(knobs[i].ready());
+      ACE128SIM_CHECK(knobs[i].result().pins == shafts[i].pins());
+      ACE128SIM_CHECK(knobs[i].result().mpos == (step + 1) * (i + 1));
+    }
+  }
+  ACE128SIM_CHECK(ACE128sim.transactions == 300 * 3);
+  ACE128SIM_CHECK(ACE128sim.nacks == 0);
+  // nobody at 0x22 - its read gives the bus up after each NACK and then times out, and the others still finish
+  for (uint8_t i = 0; i < 3; i++) shafts[i].turn(1);
+  readAll(4);
+  for (uint8_t i = 0; i < 3; i++) ACE128SIM_CHECK(knobs[i].result().pins == shafts[i].pins());
+  ACE128SIM_CHECK(knobs[3].result().pins == 0xFF);
+  ACE128SIM_CHECK(ACE128sim.nacks > 1);
+  return (ACE128SIM_DONE());
+}
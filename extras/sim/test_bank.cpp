@@ -0,0 +1,96 @@
+/*
+  test_bank.cpp - ACE128bank against ACE128 on a full bus of 16 expanders
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128bank.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+const uint8_t KNOBS = 16;           // every PCF8574 and PCF8574A address, MCP23008s on some with ACE128_MCP23008
+ACE128simShaft shafts[KNOBS];
+ACE128 *knobs[KNOBS];
+ACE128simMCP23008 *mcps[KNOBS];
+ACE128bank<KNOBS> panel(MAP);
+
+uint8_t address(uint8_t n)
+{
+  return ((n < 8 ? 0x20 : 0x38) + (n & 7));
+}
+
+bool isMcp(uint8_t n)
+{
+#ifdef ACE128_MCP23008
+  return (n < 8 && (n & 1));
+#else
+  (void)n;
+  return (false);
+#endif
+}
+
+int main()
+{
+  for (uint8_t n = 0; n < KNOBS; n++)
+  {
+    shafts[n].set(n * 8);
+    if (isMcp(n))
+    {
+      mcps[n] = new ACE128simMCP23008(shafts[n]);
+      mcps[n]->reg[ACE128simMCP23008::IOCON] = 0x20;  // SEQOP left set by a reset that kept the chip powered
+      ACE128sim.attach(address(n), *mcps[n]);
+      panel.set(n, address(n) & 0x07);
+      knobs[n] = new ACE128(address(n) & 0x07, MAP);
+    }
+    else
+    {
+      ACE128sim.attach(address(n), *new ACE128simPCF8574(shafts[n]));
+      panel.set(n, address(n));
+      knobs[n] = new ACE128(address(n), MAP);
+    }
+    if (n % 3 == 1) panel.reverse(n, true);
+  }
+  panel.begin();
+  for (uint8_t n = 0; n < KNOBS; n++)
+  {
+    if (isMcp(n)) ACE128SIM_CHECK(mcps[n]->reg[ACE128simMCP23008::GPPU] == 0xFF);  // pullups on
+    knobs[n]->begin();
+    knobs[n]->reverse(n % 3 == 1);
+    ACE128SIM_CHECK(panel.getZero(n) == knobs[n]->getZero());
+  }
+  uint32_t seed = 1;
+  for (int step = 0; step < 3000; step++)
+  {
+    for (uint8_t n = 0; n < KNOBS; n++)
+    {
+      seed = seed * 1103515245 + 12345;
+      shafts[n].turn((int8_t)((seed >> 16) % 81) - 40);  // under half a turn between reads
+    }
+    if (step == 1000)
+    {
+      for (uint8_t n = 0; n < KNOBS; n++)
+      {
+        panel.setMpos(n, n * 100 - 800);
+        knobs[n]->setMpos(n * 100 - 800);
+      }
+    }
+    if (step == 2000)
+    {
+      for (uint8_t n = 0; n < KNOBS; n++)
+      {
+        panel.setZero(n);
+        knobs[n]->setZero();
+      }
+    }
+    ACE128sim.reset();
+    panel.update();
+    ACE128SIM_CHECK(ACE128sim.transactions == KNOBS);  // one read each
+    for (uint8_t n = 0; n < KNOBS; n++)
+    {
+      ACE128sample s = knobs[n]->sample();
+      ACE128SIM_CHECK(panel.mpos(n) == s.mpos && panel.pos(n) == s.pos && panel.upos(n) == s.upos);
+    }
+  }
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,101 @@
+/*
+  test_calibrate.cpp - ACE128calibrate finding each wiring, next to an encoder that keeps its PROGMEM map
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128calibrate.h>
+#include <ACE128map12345678.h>
+#include <ACE128map12348765.h>
+#include <ACE128map18762345.h>
+#include <ACE128map87654321.h>
+
+struct Wiring
+{
+  uint8_t order[8];
+  const uint8_t *map;              // the shipped map calibration should settle on, NULL if there is none
+};
+
+const Wiring wirings[9] = {
+  { { 8, 7, 6, 5, 4, 3, 2, 1 }, encoderMap_87654321 }, { { 1, 2, 3, 4, 5, 6, 7, 8 }, encoderMap_12345678 },
+  { { 1, 2, 3, 4, 8, 7, 6, 5 }, encoderMap_12348765 }, { { 5, 6, 7, 8, 4, 3, 2, 1 }, encoderMap_12348765 },
+  { { 1, 8, 7, 6, 2, 3, 4, 5 }, encoderMap_18762345 }, { { 5, 4, 3, 2, 6, 7, 8, 1 }, encoderMap_18762345 },
+  { { 8, 7, 6, 5, 1, 2, 3, 4 }, encoderMap_18762345 }, { { 3, 1, 4, 8, 2, 7, 5, 6 }, NULL },
+  { { 2, 5, 8, 3, 6, 1, 4, 7 }, NULL }
+};
+
+ACE128simShaft shaft;
+ACE128simShaft other;
+ACE128simPCF8574 chip(shaft);
+ACE128simPCF8574 otherChip(other);
+#ifdef ACE128_COMPACT_MAP
+uint8_t knobMap[8];
+ACE128 otherKnob(0x21, (uint8_t *)ACE128map<8, 7, 6, 5, 4, 3, 2, 1>::order);
+#else
+uint8_t knobMap[256];
+ACE128 otherKnob(0x21, (uint8_t *)encoderMap_87654321);
+#endif
+
+void calibrate(const Wiring &w)
+{
+  shaft.wire(w.order);
+  shaft.set(0);
+#ifdef ACE128_COMPACT_MAP
+  for (uint8_t i = 0; i < 8; i++) knobMap[i] = i + 1;   // any valid order until calibrated
+#else
+  memset(knobMap, 0xFF, sizeof(knobMap));              // no valid codes until calibrated
+#endif
+  ACE128 knob(0x20, knobMap);
+  knob.setMap(knobMap, true);
+  knob.begin();
+  unsigned long transactions = ACE128sim.transactions;
+  ACE128calibrate cal(knob);
+  ACE128SIM_CHECK(ACE128sim.transactions == transactions);  // nothing read until update()
+  unsigned long calls = 0;
+  uint8_t status = ACE128_CAL_TURNING;
+  while (status == ACE128_CAL_TURNING && calls < 100000)
+  {
+    if (calls % 2 == 0) shaft.turn(1);   // each code read twice running
+    status = cal.update();
+    calls++;
+  }
+  ACE128SIM_CHECK(status == ACE128_CAL_DONE);
+  // half a turn of codes, or all of them if more were asked for, two calls each, then the last search alone tried
+  // 5040 orders a few a call, starting on the call that saw its first code
+  const unsigned long codes = ACE128_CALIBRATE_CODES < 128 ? ACE128_CALIBRATE_CODES : 128;
+  ACE128SIM_CHECK(calls >= 2 * codes + 5040 / ACE128_CALIBRATE_STEP - 1);
+#ifdef ACE128_COMPACT_MAP
+  ACE128SIM_CHECK(cal.getOrder(knobMap));
+#else
+  ACE128SIM_CHECK(cal.makeMap(knobMap));
+  if (w.map != NULL) ACE128SIM_CHECK(memcmp(knobMap, w.map, 256) == 0);
+#endif
+  // both knobs count right, each from its own kind of map
+  knob.setMpos(0);
+  otherKnob.setMpos(0);
+  for (int i = 1; i <= 300; i++)
+  {
+    shaft.turn(-1);
+    other.turn(1);
+    unsigned long pgm = ACE128sim.pgmReads;
+    ACE128SIM_CHECK(knob.mpos() == -i);
+#ifndef ACE128_COMPACT_MAP
+    ACE128SIM_CHECK(ACE128sim.pgmReads == pgm);  // the RAM map isn't read as PROGMEM
+#endif
+    ACE128SIM_CHECK(otherKnob.mpos() == i);
+    ACE128SIM_CHECK(ACE128sim.pgmReads > pgm);
+  }
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  ACE128sim.attach(0x21, otherChip);
+  otherKnob.begin();
+  for (uint8_t w = 0; w < 9; w++)
+  {
+    calibrate(wirings[w]);
+  }
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,102 @@
+/*
+  test_compact.cpp - ACE128_COMPACT_MAP decoding against the shipped encoderMap_ arrays for all 256 pin codes
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128map.h>
+#include <ACE128map12345678.h>
+#include <ACE128map12348765.h>
+#include <ACE128map18762345.h>
+#include <ACE128map54326781.h>
+#include <ACE128map56784321.h>
+#include <ACE128map87651234.h>
+#include <ACE128map87654321.h>
+
+// the flash each way of decoding takes for its tables
+static_assert(sizeof(encoderMap_87654321) == 256, "a map is 256 bytes per wiring");
+static_assert(sizeof(ACE128_compact) == 32, "the compact table is 32 bytes for every wiring");
+static_assert(sizeof(ACE128map<8, 7, 6, 5, 4, 3, 2, 1>::order) == 8, "plus a pin order of 8 bytes per wiring");
+
+// an expander whose pins read whatever code we like
+class CodeSource : public ACE128simDevice
+{
+  public:
+    uint8_t pins;
+    bool write(const uint8_t *data, uint8_t len) { (void)data; (void)len; return (true); }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) data[i] = pins;
+      return (true);
+    }
+};
+CodeSource chip;
+
+#ifdef ACE128_RECOVER
+// what _recover() makes of an invalid code with the table, for last good position lastraw
+uint8_t recovered(const uint8_t *map, uint8_t pins, uint8_t lastraw)
+{
+  for (uint8_t dist = 1; dist <= 2; dist++)
+  {
+    uint8_t best = 0xFF;
+    uint8_t bestGap = 0xFF;
+    for (uint8_t i = 0; i <= 7; i++)
+    {
+      for (uint8_t j = (dist == 1) ? i : i + 1; j <= 7; j++)
+      {
+        uint8_t raw = map[pins ^ (1 << i) ^ ((dist == 1) ? 0 : 1 << j)];
+        uint8_t gap = (raw - lastraw) & 0x7F;
+        if (gap > 0x40) gap = 0x80 - gap;
+        if (raw != 0xFF && gap < bestGap)
+        {
+          bestGap = gap;
+          best = raw;
+        }
+        if (dist == 1) break;
+      }
+    }
+    if (best != 0xFF) return (best);
+  }
+  return (lastraw);
+}
+#endif
+
+template <uint8_t P0, uint8_t P1, uint8_t P2, uint8_t P3, uint8_t P4, uint8_t P5, uint8_t P6, uint8_t P7>
+void check(const uint8_t *shipped)
+{
+  ACE128 knob(0x20, (uint8_t *)ACE128map<P0, P1, P2, P3, P4, P5, P6, P7>::order);
+  chip.pins = ACE128map<P0, P1, P2, P3, P4, P5, P6, P7>::codes[0];
+  knob.begin();
+#ifdef ACE128_RECOVER
+  uint8_t lastraw = 0;
+#endif
+  int bad = 0;
+  for (uint16_t pins = 0; pins < 256; pins++)
+  {
+    chip.pins = pins;
+    uint8_t expect = shipped[pins];
+#ifdef ACE128_RECOVER
+    if (expect == 0xFF) expect = recovered(shipped, pins, lastraw);
+#endif
+    uint8_t raw = knob.rawPos();
+    if (raw != expect) bad++;
+#ifdef ACE128_RECOVER
+    lastraw = raw;
+#endif
+  }
+  ACE128SIM_CHECK(bad == 0);
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  check<1, 2, 3, 4, 5, 6, 7, 8>(encoderMap_12345678);
+  check<1, 2, 3, 4, 8, 7, 6, 5>(encoderMap_12348765);
+  check<1, 8, 7, 6, 2, 3, 4, 5>(encoderMap_18762345);
+  check<5, 4, 3, 2, 6, 7, 8, 1>(encoderMap_54326781);
+  check<5, 6, 7, 8, 4, 3, 2, 1>(encoderMap_56784321);
+  check<8, 7, 6, 5, 1, 2, 3, 4>(encoderMap_87651234);
+  check<8, 7, 6, 5, 4, 3, 2, 1>(encoderMap_87654321);
+  return (ACE128SIM_DONE());
+}
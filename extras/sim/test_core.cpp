@@ -0,0 +1,175 @@
+/*
+  test_core.cpp - the basic ACE128 interface on a simulated knob, built once for each configuration in CMakeLists.txt
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128map12345678.h>
+#include <ACE128map12348765.h>
+#include <ACE128map18762345.h>
+#include <ACE128map54326781.h>
+#include <ACE128map56784321.h>
+#include <ACE128map87651234.h>
+#include <ACE128map87654321.h>
+
+struct Wiring
+{
+  uint8_t order[8];
+  const uint8_t *map;
+};
+
+const Wiring wirings[7] = {
+  { { 1, 2, 3, 4, 5, 6, 7, 8 }, encoderMap_12345678 }, { { 1, 2, 3, 4, 8, 7, 6, 5 }, encoderMap_12348765 },
+  { { 1, 8, 7, 6, 2, 3, 4, 5 }, encoderMap_18762345 }, { { 5, 4, 3, 2, 6, 7, 8, 1 }, encoderMap_54326781 },
+  { { 5, 6, 7, 8, 4, 3, 2, 1 }, encoderMap_56784321 }, { { 8, 7, 6, 5, 1, 2, 3, 4 }, encoderMap_87651234 },
+  { { 8, 7, 6, 5, 4, 3, 2, 1 }, encoderMap_87654321 }
+};
+
+uint8_t *mapFor(const Wiring &w)
+{
+#ifdef ACE128_COMPACT_MAP
+  return ((uint8_t *)w.order);
+#else
+  return ((uint8_t *)w.map);
+#endif
+}
+
+ACE128simShaft shaft;
+ACE128simEEPROM i2cEeprom;
+#ifdef ACE128_ARDUINO_PINS
+const uint8_t knobPins[8] = { 2, 3, 4, 5, 6, 7, 8, 9 };
+  #define KNOB(map, ...) ACE128 knob(2, 3, 4, 5, 6, 7, 8, 9, map, ##__VA_ARGS__)
+#elif defined(ACE128_MCP23008)
+ACE128simMCP23008 chip(shaft);
+  #define KNOB(map, ...) ACE128 knob(0x01, map, ##__VA_ARGS__)
+#else
+ACE128simPCF8574 chip(shaft);
+  #define KNOB(map, ...) ACE128 knob(0x20, map, ##__VA_ARGS__)
+#endif
+
+// every wiring decodes every position
+void testWirings()
+{
+  for (uint8_t w = 0; w < 7; w++)
+  {
+    shaft.wire(wirings[w].order);
+    shaft.set(0);
+    KNOB(mapFor(wirings[w]));
+    knob.begin();
+    for (uint8_t raw = 0; raw < 128; raw++)
+    {
+      shaft.set(raw);
+      ACE128SIM_CHECK(knob.rawPos() == raw);
+    }
+  }
+  shaft.wire(wirings[6].order);
+}
+
+// turning, jumps, zero, reverse and sample()
+void testTracking()
+{
+  shaft.set(100);
+  KNOB(mapFor(wirings[6]));
+  knob.begin();
+  ACE128SIM_CHECK(knob.getZero() == 100);
+  ACE128SIM_CHECK(knob.mpos() == 0);
+  int16_t mpos = 0;
+  for (int i = 0; i < 3 * 128; i++)
+  {
+    shaft.turn(1);
+    ACE128SIM_CHECK(knob.mpos() == ++mpos);
+  }
+  for (int i = 0; i < 5 * 128; i++)
+  {
+    shaft.turn(-1);
+    ACE128SIM_CHECK(knob.mpos() == --mpos);
+  }
+  for (int8_t jump = 1; jump < 64; jump += 7)  // anything under half a turn between reads is followed
+  {
+    shaft.turn(jump);
+    mpos += jump;
+    ACE128SIM_CHECK(knob.mpos() == mpos);
+    shaft.turn(-jump - 1);
+    mpos -= jump + 1;
+    ACE128SIM_CHECK(knob.mpos() == mpos);
+  }
+  ACE128sample s = knob.sample();
+  ACE128SIM_CHECK(s.mpos == mpos && s.raw == shaft.raw() && s.pins == shaft.pins());
+  ACE128SIM_CHECK(s.upos == knob.upos() && s.pos == knob.pos());
+  knob.setZero();
+  ACE128SIM_CHECK(knob.pos() == 0 && knob.getZero() == shaft.raw());
+  knob.setMpos(1000);
+  ACE128SIM_CHECK(knob.mpos() == 1000);
+  shaft.turn(5);
+  ACE128SIM_CHECK(knob.mpos() == 1005);
+  knob.reverse(true);
+  knob.setMpos(0);
+  shaft.turn(5);
+  ACE128SIM_CHECK(knob.mpos() == -5);
+  knob.reverse(false);
+}
+
+// after begin() each position call is one bus transaction
+void testBusUse()
+{
+#ifndef ACE128_ARDUINO_PINS
+  KNOB(mapFor(wirings[6]));
+  knob.begin();
+  knob.mpos();
+  ACE128sim.reset();
+  unsigned long saves = i2cEeprom.writes;
+  for (int i = 0; i < 100; i++)
+  {
+    shaft.turn(1);
+    knob.upos();
+    knob.pos();
+    knob.mpos();
+    knob.sample();
+  }
+  ACE128SIM_CHECK(ACE128sim.transactions == 400 + i2cEeprom.writes - saves);  // and any EEPROM saves
+#endif
+}
+
+#ifndef ACE128_EEPROM_NONE
+// a knob made again at the same address picks up where the last one left off
+void testRestore()
+{
+  shaft.set(30);
+  {
+    KNOB(mapFor(wirings[6]), 64);
+    knob.begin();
+    knob.setMpos(-300);
+    for (int i = 0; i < 700; i++)
+    {
+      shaft.turn(1);
+      knob.mpos();
+    }
+  #ifdef ACE128_EEPROM_JOURNAL
+    knob.flush();
+  #endif
+  }
+  KNOB(mapFor(wirings[6]), 64);
+  knob.begin();
+  ACE128SIM_CHECK(knob.mpos() == 400);
+}
+#endif
+
+int main()
+{
+#ifdef ACE128_ARDUINO_PINS
+  ACE128sim.connect(knobPins, shaft);
+#elif defined(ACE128_MCP23008)
+  ACE128sim.attach(0x21, chip);
+#else
+  ACE128sim.attach(0x20, chip);
+#endif
+  ACE128sim.attach(0x50, i2cEeprom);
+  testWirings();
+  testTracking();
+  testBusUse();
+#ifndef ACE128_EEPROM_NONE
+  testRestore();
+#endif
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,200 @@
+/*
+  test_events.cpp - ACE128_EVENTS move, turn and direction events, detents with hysteresis and the event queue
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_EVENTS
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+
+ACE128simShaft shaft;
+ACE128simPCF8574 chip(shaft);
+
+// the next queued event is this one
+bool next(ACE128 &knob, uint8_t event, int16_t value)
+{
+  ACE128event e;
+  return (knob.readEvent(e) && e.event == event && e.value == value);
+}
+
+bool none(ACE128 &knob)
+{
+  ACE128event e;
+  return (!knob.readEvent(e));
+}
+
+// move to mpos, a step at a time so every position gets read
+void walk(ACE128 &knob, int16_t mpos)
+{
+  int16_t at = knob.mpos();
+  while (at != mpos)
+  {
+    shaft.turn(mpos > at ? 1 : -1);
+    at = knob.mpos();
+  }
+}
+
+// every step a detent by default
+void testSteps()
+{
+  shaft.set(0);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  knob.mpos();
+  ACE128SIM_CHECK(none(knob));                    // where we start is not a move
+  shaft.turn(1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, 1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 1));
+  ACE128SIM_CHECK(none(knob));
+  ACE128SIM_CHECK(knob.detent() == 1);
+  shaft.turn(1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 2));   // no new direction
+  ACE128SIM_CHECK(none(knob));
+  shaft.turn(-1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, -1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 1));
+  ACE128SIM_CHECK(none(knob));
+  knob.mpos();                                    // no move, no events
+  ACE128SIM_CHECK(none(knob));
+  // into turn -1 and back into turn 0
+  walk(knob, 0);
+  while (!none(knob)) {}
+  shaft.turn(-1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, -1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_TURN, -1));
+  ACE128SIM_CHECK(none(knob));
+  shaft.turn(1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, 1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 0));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_TURN, 0));
+  ACE128SIM_CHECK(none(knob));
+  // a jump of several detents is one move
+  shaft.turn(40);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 40));
+  ACE128SIM_CHECK(none(knob));
+  // setting the position is not a move
+  knob.setMpos(500);
+  knob.mpos();
+  ACE128SIM_CHECK(none(knob));
+  ACE128SIM_CHECK(knob.detent() == 500);
+}
+
+// 16 detents a turn, 8 steps each, and 3 steps of hysteresis: detent d runs from 8d - 4 to 8d + 3
+void testDetents()
+{
+  shaft.set(0);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  knob.setDetents(16, 3);
+  knob.mpos();
+  // a knob resting on the boundary between detents 0 and 1, and jittering up to 2 steps past it, stays in detent 0
+  for (int i = 0; i < 50; i++)
+  {
+    walk(knob, 3 + i % 4);
+    walk(knob, 3);
+  }
+  ACE128SIM_CHECK(none(knob));
+  ACE128SIM_CHECK(knob.detent() == 0);
+  // 3 steps past the boundary it moves
+  walk(knob, 7);
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, 1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 1));
+  ACE128SIM_CHECK(none(knob));
+  // and the same going back - down to 3 steps below the boundary is still detent 1
+  for (int i = 0; i < 50; i++)
+  {
+    walk(knob, 1 + i % 7);
+  }
+  ACE128SIM_CHECK(none(knob));
+  ACE128SIM_CHECK(knob.detent() == 1);
+  walk(knob, 0);
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, -1));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 0));
+  ACE128SIM_CHECK(none(knob));
+  // a turn is 16 detents, reached 3 steps past the boundary at 124
+  walk(knob, 125);
+  while (!none(knob)) {}
+  ACE128SIM_CHECK(knob.detent() == 15);
+  walk(knob, 126);
+  ACE128SIM_CHECK(none(knob));
+  shaft.turn(1);
+  knob.mpos();                                    // 127, 124 + 3
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, 16));
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_TURN, 1));
+  ACE128SIM_CHECK(none(knob));
+}
+
+// readEvent() hands the queue out oldest first, and what doesn't fit is dropped - the next move catches up
+void testQueue()
+{
+  shaft.set(0);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  knob.mpos();
+  for (int i = 1; i <= ACE128_EVENTS_QUEUE + 2; i++)
+  {
+    shaft.turn(1);
+    knob.mpos();
+  }
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_DIRECTION, 1));
+  for (int i = 1; i < ACE128_EVENTS_QUEUE; i++)
+  {
+    ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, i));
+  }
+  ACE128SIM_CHECK(none(knob));
+  ACE128SIM_CHECK(knob.detent() == ACE128_EVENTS_QUEUE + 2);
+  shaft.turn(1);
+  knob.mpos();
+  ACE128SIM_CHECK(next(knob, ACE128_EVENT_MOVE, ACE128_EVENTS_QUEUE + 3));
+  ACE128SIM_CHECK(none(knob));
+}
+
+// with a handler nothing is queued
+uint8_t handled[8];
+int16_t handledValue[8];
+uint8_t handledCount;
+void handler(ACE128 &encoder, uint8_t event, int16_t value)
+{
+  (void)encoder;
+  if (handledCount < 8)
+  {
+    handled[handledCount] = event;
+    handledValue[handledCount] = value;
+  }
+  handledCount++;
+}
+
+void testHandler()
+{
+  shaft.set(0);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  knob.onEvent(handler);
+  knob.mpos();
+  shaft.turn(-3);
+  knob.mpos();
+  ACE128SIM_CHECK(handledCount == 3);
+  ACE128SIM_CHECK(handled[0] == ACE128_EVENT_DIRECTION && handledValue[0] == -1);
+  ACE128SIM_CHECK(handled[1] == ACE128_EVENT_MOVE && handledValue[1] == -3);
+  ACE128SIM_CHECK(handled[2] == ACE128_EVENT_TURN && handledValue[2] == -1);
+  ACE128SIM_CHECK(none(knob));
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  testSteps();
+  testDetents();
+  testQueue();
+  testHandler();
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,77 @@
+/*
+  test_expander16.cpp - two encoders on each of the MCP23017, PCA9555 and PCF8575 through ACE128expander16
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+
+ACE128simShaft shaftA;
+ACE128simShaft shaftB;
+
+void check(uint8_t addr, uint8_t chipType)
+{
+  ACE128expander16 chip(addr, chipType);
+  ACE128 knobA(chip, 0, MAP);
+  ACE128 knobB(chip, 1, MAP);
+  shaftA.set(0);
+  shaftB.set(0);
+  knobA.begin();
+  knobB.begin();
+
+  // both ports through the whole turn, the B shaft going the other way
+  for (uint8_t raw = 0; raw < 128; raw++)
+  {
+    shaftA.set(raw);
+    shaftB.set(127 - raw);
+    ACE128sim.reset();
+    ACE128SIM_CHECK(knobA.rawPos() == raw);
+    ACE128SIM_CHECK(knobB.rawPos() == 127 - raw);
+    ACE128SIM_CHECK(ACE128sim.transactions == 1);  // one 2 byte read for the pair
+    ACE128SIM_CHECK(ACE128sim.busBytes == 2);
+  }
+
+  // either order, and a port read twice goes back to the bus
+  ACE128sim.reset();
+  knobB.rawPos();
+  knobA.rawPos();
+  ACE128SIM_CHECK(ACE128sim.transactions == 1);
+  knobA.rawPos();
+  ACE128SIM_CHECK(ACE128sim.transactions == 2);
+
+  // the other port's byte goes stale - read it much later and it comes from the bus, not from the last read
+  shaftA.set(10);
+  shaftB.set(20);
+  ACE128SIM_CHECK(knobA.rawPos() == 10);
+  shaftB.set(30);
+  ACE128sim.advance(1000UL * (ACE128_EXPANDER16_MS + 1));
+  ACE128sim.reset();
+  ACE128SIM_CHECK(knobB.rawPos() == 30);
+  ACE128SIM_CHECK(ACE128sim.transactions == 1);
+  // and a quick pair still shares
+  ACE128SIM_CHECK(knobA.rawPos() == 10);
+  ACE128SIM_CHECK(ACE128sim.transactions == 1);
+}
+
+int main()
+{
+  ACE128simMCP23017 mcp(shaftA, shaftB);
+  mcp.reg[ACE128simMCP23017::IOCON] = 0x20;  // SEQOP left set by a reset that kept the chip powered
+  mcp.reg[ACE128simMCP23017::IOCON2] = 0x20;
+  ACE128simPCA9555 pca(shaftA, shaftB);
+  ACE128simPCF8575 pcf(shaftA, shaftB);
+  ACE128sim.attach(0x20, mcp);
+  ACE128sim.attach(0x21, pca);
+  ACE128sim.attach(0x22, pcf);
+  check(0x20, ACE128_CHIP_MCP23017);
+  ACE128SIM_CHECK(mcp.reg[ACE128simMCP23017::GPPUA] == 0xFF && mcp.reg[ACE128simMCP23017::GPPUB] == 0xFF);
+  ACE128SIM_CHECK(mcp.reg[ACE128simMCP23017::IODIRA] == 0xFF && mcp.reg[ACE128simMCP23017::IODIRB] == 0xFF);
+  ACE128SIM_CHECK(mcp.reg[ACE128simMCP23017::IOCON] == 0x20);  // SEQOP, to keep the pointer on the GPIO pair
+  check(0x21, ACE128_CHIP_PCA9555);
+  ACE128SIM_CHECK(pca.reg[ACE128simPCA9555::CONFIG0] == 0xFF && pca.reg[ACE128simPCA9555::CONFIG1] == 0xFF);
+  check(0x22, ACE128_CHIP_PCF8575);
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,66 @@
+/*
+  test_group.cpp - ACE128group scanning a mixed panel, on expanders or direct pins
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128group.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+#ifdef ACE128_ARDUINO_PINS
+const uint8_t KNOBS = 2;
+ACE128simShaft shafts[KNOBS];
+const uint8_t pins[KNOBS][8] = { { 2, 3, 4, 5, 6, 7, 8, 9 }, { 10, 11, 12, 13, 14, 15, 16, 17 } };
+ACE128 knobs[KNOBS] = { ACE128(2, 3, 4, 5, 6, 7, 8, 9, MAP), ACE128(10, 11, 12, 13, 14, 15, 16, 17, MAP) };
+#else
+const uint8_t KNOBS = 6;
+ACE128simShaft shafts[KNOBS];
+  #ifdef ACE128_MCP23008
+ACE128 knobs[KNOBS] = { ACE128(0x20, MAP), ACE128(0x38, MAP), ACE128(0x02, MAP),
+                        ACE128(0x21, MAP), ACE128(0x39, MAP), ACE128(0x03, MAP) };
+  #else
+ACE128 knobs[KNOBS] = { ACE128(0x20, MAP), ACE128(0x38, MAP), ACE128(0x22, MAP),
+                        ACE128(0x21, MAP), ACE128(0x39, MAP), ACE128(0x23, MAP) };
+  #endif
+const uint8_t addrs[KNOBS] = { 0x20, 0x38, 0x22, 0x21, 0x39, 0x23 };
+#endif
+ACE128group panel;
+
+int main()
+{
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+#ifdef ACE128_ARDUINO_PINS
+    ACE128sim.connect(pins[i], shafts[i]);
+#else
+  #ifdef ACE128_MCP23008
+    if (i % 3 == 2) ACE128sim.attach(addrs[i], *new ACE128simMCP23008(shafts[i]));
+    else
+  #endif
+    ACE128sim.attach(addrs[i], *new ACE128simPCF8574(shafts[i]));
+#endif
+    shafts[i].set(i * 20);
+    ACE128SIM_CHECK(panel.add(knobs[i]) == i);
+  }
+  panel.begin(400000);
+#ifndef ACE128_ARDUINO_PINS
+  ACE128SIM_CHECK(ACE128sim.wireBegins == 1 && ACE128sim.clock == 400000);
+#endif
+  for (int step = 1; step <= 500; step++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++) shafts[i].turn(i % 2 ? -1 : 2);
+    ACE128sim.reset();
+    ACE128SIM_CHECK(panel.scan());
+    for (uint8_t i = 0; i < KNOBS; i++)
+    {
+      ACE128SIM_CHECK(panel.sample(i).mpos == step * (i % 2 ? -1 : 2));
+      ACE128SIM_CHECK(panel.sample(i).raw == shafts[i].raw());
+    }
+#ifndef ACE128_ARDUINO_PINS
+    ACE128SIM_CHECK(ACE128sim.transactions == KNOBS);  // one read each
+#endif
+  }
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,146 @@
+/*
+  test_interrupt.cpp - ACE128_INTERRUPT: no bus reads while INT is high, a read when it goes low, and a fresh read
+  after begin() whatever INT says, with one expander on the pin and with two sharing it
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_INTERRUPT
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+const uint8_t INT_PIN = 2;
+
+ACE128simShaft shaft0;
+ACE128simShaft shaft1;
+ACE128simPCF8574 chip0(shaft0);
+#ifdef ACE128_MCP23008
+ACE128simMCP23008 chip1(shaft1);
+ACE128 knob0(0x20, MAP);
+ACE128 knob1(0x02, MAP);
+#else
+ACE128simPCF8574 chip1(shaft1);
+ACE128 knob0(0x20, MAP);
+ACE128 knob1(0x22, MAP);
+#endif
+
+// what a read of the chip at addr by someone else - a logic analyser, another library - does to INT
+void otherRead(uint8_t addr)
+{
+  uint8_t b;
+  ACE128sim.read(addr, &b, 1);
+}
+
+// knob1 alone on the pin
+void testQuiet()
+{
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+  ACE128sim.reset();
+  for (int i = 0; i < 100; i++) ACE128SIM_CHECK(knob1.mpos() == 0);
+  ACE128SIM_CHECK(ACE128sim.transactions == 0);   // INT high, nothing to read
+  ACE128SIM_CHECK(ACE128sim.digitalReads == 100);
+  // a move pulls INT low, one read, and the read releases it
+  for (int i = 1; i <= 50; i++)
+  {
+    shaft1.turn(3);
+    ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 0);
+    ACE128SIM_CHECK(knob1.changed());
+    ACE128sim.reset();
+    ACE128SIM_CHECK(knob1.mpos() == 3 * i);
+    ACE128SIM_CHECK(ACE128sim.transactions == 1);
+    ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+    ACE128SIM_CHECK(!knob1.changed());
+    ACE128SIM_CHECK(knob1.mpos() == 3 * i);
+    ACE128SIM_CHECK(ACE128sim.transactions == 1);
+  }
+}
+
+// begin() again with INT released by someone else's read: the pins it last read are no good, so it reads anyway
+void testStale()
+{
+  shaft1.turn(10);
+  otherRead(0x22);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+  ACE128sim.reset();
+  knob1.begin();                                 // zero where the knob is now
+  ACE128SIM_CHECK(ACE128sim.transactions > 0);
+  ACE128SIM_CHECK(knob1.mpos() == 0);
+  shaft1.turn(2);
+  ACE128SIM_CHECK(knob1.mpos() == 2);           // not 12, from the pins before the turn
+  ACE128sim.reset();
+  ACE128SIM_CHECK(knob1.mpos() == 2);
+  ACE128SIM_CHECK(ACE128sim.transactions == 0);
+}
+
+// two expanders on one INT pin: a move on either makes both read until each has cleared its own INT
+void testShared()
+{
+  ACE128sim.connectInt(INT_PIN, chip0);
+  knob0.setIntPin(INT_PIN);
+  knob0.begin();
+  knob0.mpos();
+  knob1.mpos();
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+  int16_t at0 = knob0.mpos();
+  int16_t at1 = knob1.mpos();
+  ACE128sim.reset();
+  for (int i = 0; i < 20; i++)
+  {
+    ACE128SIM_CHECK(knob0.mpos() == at0 && knob1.mpos() == at1);
+  }
+  ACE128SIM_CHECK(ACE128sim.transactions == 0);
+  shaft0.turn(-5);
+  ACE128sim.reset();
+  ACE128SIM_CHECK(knob1.mpos() == at1);         // a wasted read - the pin can't say whose INT it is
+  ACE128SIM_CHECK(ACE128sim.transactions == 1);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 0);
+  ACE128SIM_CHECK(knob0.mpos() == at0 - 5);
+  ACE128SIM_CHECK(ACE128sim.transactions == 2);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+  ACE128SIM_CHECK(knob0.mpos() == at0 - 5 && knob1.mpos() == at1);
+  ACE128SIM_CHECK(ACE128sim.transactions == 2);
+  // both move
+  shaft0.turn(7);
+  shaft1.turn(-9);
+  ACE128SIM_CHECK(knob0.mpos() == at0 + 2);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 0);   // knob1's chip still has it
+  ACE128SIM_CHECK(knob1.mpos() == at1 - 9);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+}
+
+#ifdef ACE128_MCP23008
+// the MCP23008 latches a change - a move there and back still asserts INT, and is read
+void testLatched()
+{
+  int16_t at = knob1.mpos();
+  shaft1.turn(4);
+  shaft1.turn(-4);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 0);
+  ACE128sim.reset();
+  ACE128SIM_CHECK(knob1.mpos() == at);
+  ACE128SIM_CHECK(ACE128sim.transactions == 1);
+  ACE128SIM_CHECK(ACE128sim.pinLevel(INT_PIN) == 1);
+}
+#endif
+
+int main()
+{
+  ACE128sim.attach(0x20, chip0);
+  ACE128sim.attach(0x22, chip1);
+  ACE128sim.connectInt(INT_PIN, chip1);
+  shaft1.set(40);
+  otherRead(0x22);               // INT released before the knob ever looked
+  knob1.setIntPin(INT_PIN);
+  ACE128sim.reset();
+  knob1.begin();                 // reads the chip anyway
+  ACE128SIM_CHECK(ACE128sim.transactions > 0);
+  ACE128SIM_CHECK(knob1.rawPos() == 40);
+  testQuiet();
+  testStale();
+  testShared();
+#ifdef ACE128_MCP23008
+  testLatched();
+#endif
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,92 @@
+/*
+  test_linux.cpp - extras/linux Wire.h on the simulated bus, through its ACE128_I2C_OPEN and ACE128_I2C_IOCTL hooks
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Built against extras/linux/Arduino.h and Wire.h instead of the ones here - see CMakeLists.txt.
+*/
+
+#include "ACE128sim.h"
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// every I2C_RDWR message is a transaction on the simulated bus
+unsigned long ioctls = 0;
+int fakeOpen(const char *path, int flags)
+{
+  (void)path;
+  (void)flags;
+  return (3);
+}
+int fakeIoctl(int fd, unsigned long request, struct i2c_rdwr_ioctl_data *data)
+{
+  (void)fd;
+  if (request != I2C_RDWR) return (-1);
+  ioctls++;
+  for (unsigned m = 0; m < data->nmsgs; m++)
+  {
+    struct i2c_msg &msg = data->msgs[m];
+    bool ack = (msg.flags & I2C_M_RD) ? ACE128sim.read(msg.addr, msg.buf, msg.len)
+                                      : ACE128sim.write(msg.addr, msg.buf, msg.len);
+    if (!ack) return (-1);         // ENXIO, as the adapter reports a NACK
+  }
+  return (0);
+}
+#define ACE128_I2C_OPEN fakeOpen
+#define ACE128_I2C_IOCTL fakeIoctl
+
+#define ACE128_MCP23008
+#include <ACE128.h>
+#include <ACE128group.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+const uint8_t KNOBS = 14;
+ACE128simShaft shafts[KNOBS];
+ACE128 *knobs[KNOBS];
+ACE128group panel;
+
+int main()
+{
+  // 8 PCF8574As, 4 MCP23008s and 2 PCF8574s
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    if (i < 8)
+    {
+      ACE128sim.attach(0x38 + i, *new ACE128simPCF8574(shafts[i]));
+      knobs[i] = new ACE128(0x38 + i, MAP);
+    }
+    else if (i < 12)
+    {
+      ACE128sim.attach(0x20 + i - 8, *new ACE128simMCP23008(shafts[i]));
+      knobs[i] = new ACE128(i - 8, MAP);
+    }
+    else
+    {
+      ACE128sim.attach(0x24 + i - 12, *new ACE128simPCF8574(shafts[i]));
+      knobs[i] = new ACE128(0x24 + i - 12, MAP);
+    }
+    shafts[i].set(9 * i);
+    panel.add(*knobs[i]);
+  }
+  panel.begin();
+  // a whole scan is one system call
+  for (int scan = 1; scan <= 100; scan++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++) shafts[i].turn(i % 2 ? 1 : -1);
+    unsigned long before = ioctls;
+    ACE128sim.reset();
+    ACE128SIM_CHECK(panel.scan());
+    ACE128SIM_CHECK(ioctls - before == 1);
+    ACE128SIM_CHECK(ACE128sim.transactions == KNOBS + 4);  // the MCP23008 pointer goes with each of their reads
+    for (uint8_t i = 0; i < KNOBS; i++) ACE128SIM_CHECK(panel.sample(i).mpos == (i % 2 ? scan : -scan));
+  }
+  // a plain read is one too
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    unsigned long before = ioctls;
+    ACE128SIM_CHECK(knobs[i]->mpos() == (i % 2 ? 100 : -100));
+    ACE128SIM_CHECK(ioctls - before == 1);
+  }
+  return (ACE128SIM_DONE());
+}
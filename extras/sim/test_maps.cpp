@@ -0,0 +1,46 @@
+/*
+  test_maps.cpp - ACE128map against the shipped encoderMap_ arrays, byte for byte, and against the simulated track
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#include <ACE128.h>
+#include <ACE128map.h>
+#include <ACE128map12345678.h>
+#include <ACE128map12348765.h>
+#include <ACE128map18762345.h>
+#include <ACE128map54326781.h>
+#include <ACE128map56784321.h>
+#include <ACE128map87651234.h>
+#include <ACE128map87654321.h>
+
+template <uint8_t P0, uint8_t P1, uint8_t P2, uint8_t P3, uint8_t P4, uint8_t P5, uint8_t P6, uint8_t P7>
+void check(const uint8_t *shipped)
+{
+  typedef ACE128map<P0, P1, P2, P3, P4, P5, P6, P7> Map;
+  const uint8_t order[8] = { P0, P1, P2, P3, P4, P5, P6, P7 };
+  int bad = 0;
+  for (uint16_t pins = 0; pins < 256; pins++)
+  {
+    if (Map::table[pins] != shipped[pins]) bad++;
+  }
+  ACE128SIM_CHECK(bad == 0);
+  for (uint8_t pos = 0; pos < 128; pos++)
+  {
+    ACE128SIM_CHECK(shipped[Map::codes[pos]] == pos);
+    ACE128SIM_CHECK(Map::codes[pos] == ACE128simShaft::code(pos, order));
+  }
+  ACE128SIM_CHECK(memcmp(Map::order, order, 8) == 0);
+}
+
+int main()
+{
+  check<1, 2, 3, 4, 5, 6, 7, 8>(encoderMap_12345678);
+  check<1, 2, 3, 4, 8, 7, 6, 5>(encoderMap_12348765);
+  check<1, 8, 7, 6, 2, 3, 4, 5>(encoderMap_18762345);
+  check<5, 4, 3, 2, 6, 7, 8, 1>(encoderMap_54326781);
+  check<5, 6, 7, 8, 4, 3, 2, 1>(encoderMap_56784321);
+  check<8, 7, 6, 5, 1, 2, 3, 4>(encoderMap_87651234);
+  check<8, 7, 6, 5, 4, 3, 2, 1>(encoderMap_87654321);
+  return (ACE128SIM_DONE());
+}
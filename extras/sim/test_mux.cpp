@@ -0,0 +1,53 @@
+/*
+  test_mux.cpp - 24 PCF8574s on three TCA9548A channels, read by ACE128group and one by one
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_MUX
+#define ACE128_GROUP_MAX 24
+#include <ACE128.h>
+#include <ACE128group.h>
+#include <ACE128map87654321.h>
+
+const uint8_t KNOBS = 24;
+ACE128simShaft shafts[KNOBS];
+ACE128simTCA9548A mux;
+ACE128 *knobs[KNOBS];
+ACE128group panel;
+
+int main()
+{
+  ACE128sim.attach(0x70, mux);
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    uint8_t addr = 0x20 + i % 8;
+    uint8_t channel = (i * 5) % 3;  // channels interleaved in add() order
+    ACE128sim.attach(addr, *new ACE128simPCF8574(shafts[i]), channel);
+    shafts[i].set(3 * i);
+    knobs[i] = new ACE128(addr, (uint8_t *)encoderMap_87654321);
+    knobs[i]->setMux(channel);
+    panel.add(*knobs[i]);
+  }
+  panel.begin();
+  // the group opens each channel once per scan
+  unsigned long switches = ACE128::muxSwitches();
+  unsigned long writes = mux.writes;
+  for (int scan = 1; scan <= 50; scan++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++) shafts[i].turn(1);
+    ACE128SIM_CHECK(panel.scan());
+    for (uint8_t i = 0; i < KNOBS; i++) ACE128SIM_CHECK(panel.sample(i).mpos == scan);
+  }
+  ACE128SIM_CHECK(ACE128::muxSwitches() - switches == 50 * 3);
+  ACE128SIM_CHECK(mux.writes - writes == 50 * 3);
+  // reading them in add() order switches for every encoder, and still gets them right
+  switches = ACE128::muxSwitches();
+  for (int pass = 1; pass <= 50; pass++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++) shafts[i].turn(-1);
+    for (uint8_t i = 0; i < KNOBS; i++) ACE128SIM_CHECK(knobs[i]->mpos() == 50 - pass);
+  }
+  ACE128SIM_CHECK(ACE128::muxSwitches() - switches == 50 * KNOBS);
+  return (ACE128SIM_DONE());
+}
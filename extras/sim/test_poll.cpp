@@ -0,0 +1,120 @@
+/*
+  test_poll.cpp - ACE128_POLL read scheduling: ambiguous(), pollInterval() and due() on a knob that spins up and stops
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_POLL
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+
+ACE128simShaft shaft;
+#ifdef ACE128_ARDUINO_PINS
+  #define KNOB ACE128 knob(2, 3, 4, 5, 6, 7, 8, 9, MAP)
+#else
+ACE128simPCF8574 chip(shaft);
+  #define KNOB ACE128 knob(0x20, MAP)
+#endif
+
+// one jump per read - past 3/8 of a turn either way is ambiguous
+void testAmbiguous()
+{
+  shaft.set(0);
+  KNOB;
+  knob.begin();
+  int16_t mpos = 0;
+  const int8_t jumps[6] = { 47, 48, -47, -48, 63, 0 };
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    ACE128sim.advance(10000);
+    shaft.turn(jumps[i]);
+    mpos += jumps[i];
+    ACE128SIM_CHECK(knob.mpos() == mpos);
+    ACE128SIM_CHECK(knob.ambiguous() == (jumps[i] >= 48 || jumps[i] <= -48));
+  }
+}
+
+// a knob at rest backs off, doubling up to ACE128_POLL_MAX_MS, and due() waits for each interval
+void testBackoff()
+{
+  shaft.set(0);
+  KNOB;
+  knob.begin();
+  uint16_t expect = ACE128_POLL_MIN_MS;
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    expect = (expect >= ACE128_POLL_MAX_MS / 2) ? ACE128_POLL_MAX_MS : expect * 2;
+    knob.mpos();
+    ACE128SIM_CHECK(knob.pollInterval() == expect);
+    ACE128SIM_CHECK(!knob.ambiguous());
+    unsigned long waited = 0;
+    while (!knob.due())
+    {
+      ACE128sim.advance(100);
+      waited += 100;
+    }
+    ACE128SIM_CHECK(waited + 1000 > 1000UL * expect && waited <= 1000UL * expect + 1000);
+  }
+  ACE128SIM_CHECK(knob.pollInterval() == ACE128_POLL_MAX_MS);
+  // a move brings it straight back down
+  shaft.turn(40);
+  ACE128SIM_CHECK(knob.mpos() == 40);
+  ACE128SIM_CHECK(knob.pollInterval() < ACE128_POLL_MAX_MS);
+}
+
+// from rest to 12 rev/s over 200 ms, a second at speed, then a stop - reading only when due() says so
+void testSpin()
+{
+  const double top = 12.0 * 128;   // steps per second
+  const double runup = 0.2;        // seconds
+  shaft.set(0);
+  KNOB;
+  knob.begin();
+  unsigned long start = ACE128sim.us;
+  long steps = 0;
+  uint16_t fastest = ACE128_POLL_MAX_MS;    // intervals once at speed
+  uint16_t slowest = 0;
+  unsigned long reads = 0;
+  while (ACE128sim.us - start < 1500000UL)
+  {
+    double t = (ACE128sim.us - start) / 1e6;
+    double at = t < runup ? top * t * t / (2 * runup) :
+                t < runup + 1.0 ? top * runup / 2 + top * (t - runup) : top * (runup / 2 + 1.0);
+    shaft.turn((int16_t)((long)at - steps));
+    steps = (long)at;
+    if (knob.due())
+    {
+      ACE128SIM_CHECK(knob.mpos() == steps);
+      ACE128SIM_CHECK(!knob.ambiguous());
+      if (t > runup + 0.1 && t < runup + 1.0)
+      {
+        if (knob.pollInterval() < fastest) fastest = knob.pollInterval();
+        if (knob.pollInterval() > slowest) slowest = knob.pollInterval();
+      }
+      reads++;
+    }
+    ACE128sim.advance(100);
+  }
+  ACE128SIM_CHECK(steps == (long)(top * (runup / 2 + 1.0)));
+  ACE128SIM_CHECK(knob.mpos() == steps);     // every turn counted
+  // a quarter turn at 1536 steps a second is about 20 ms
+  ACE128SIM_CHECK(fastest >= 18 && slowest <= 22);
+  ACE128SIM_CHECK(reads < 1500 / 18 + 20);   // and it didn't read much more often than that
+  ACE128SIM_CHECK(knob.pollInterval() == ACE128_POLL_MAX_MS);  // idle again
+}
+
+int main()
+{
+#ifdef ACE128_ARDUINO_PINS
+  const uint8_t pins[8] = { 2, 3, 4, 5, 6, 7, 8, 9 };
+  ACE128sim.connect(pins, shaft);
+#else
+  ACE128sim.attach(0x20, chip);
+#endif
+  testAmbiguous();
+  testBackoff();
+  testSpin();
+  return (ACE128SIM_DONE());
+}
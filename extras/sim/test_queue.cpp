@@ -0,0 +1,136 @@
+/*
+  test_queue.cpp - ACE128_QUEUE background sampling, including a queue that overflows while the knob spins
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_QUEUE 8
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+
+// an expander whose pins read whatever code we like
+class CodeSource : public ACE128simDevice
+{
+  public:
+    uint8_t pins;
+    bool write(const uint8_t *data, uint8_t len) { (void)data; (void)len; return (true); }
+    bool read(uint8_t *data, uint8_t len)
+    {
+      for (uint8_t i = 0; i < len; i++) data[i] = pins;
+      return (true);
+    }
+};
+
+ACE128simShaft shaft;
+ACE128simPCF8574 chip(shaft);
+CodeSource codes;
+
+// the pin code for a raw position
+uint8_t codeFor(uint8_t raw)
+{
+  for (uint16_t pins = 0; pins < 256; pins++)
+  {
+    if (encoderMap_87654321[pins] == raw) return (pins);
+  }
+  return (0);
+}
+
+void testQueue()
+{
+  ACE128 knob(0x20, MAP);
+  shaft.set(0);
+  knob.begin();
+  ACE128sample s;
+  ACE128SIM_CHECK(!knob.readQueue(s));
+  for (int i = 1; i <= 5; i++)
+  {
+    shaft.turn(30);
+    knob.isrSample();
+  }
+  for (int i = 1; i <= 5; i++)
+  {
+    ACE128SIM_CHECK(knob.readQueue(s) && s.mpos == 30 * i);
+  }
+  ACE128SIM_CHECK(!knob.readQueue(s));
+  ACE128SIM_CHECK(knob.mpos() == 150);
+  ACE128SIM_CHECK(knob.queueOverflows() == 0);
+}
+
+// loop() stalls while the knob spins 20000 steps - the queue keeps the first 8 samples, then readQueue() catches up
+void testOverflow()
+{
+  ACE128 knob(0x20, MAP);
+  shaft.set(0);
+  knob.begin();
+  for (int i = 1; i <= 1000; i++)
+  {
+    shaft.turn(20);
+    knob.isrSample();
+  }
+  ACE128SIM_CHECK(knob.queueOverflows() == 1000 - ACE128_QUEUE);
+  ACE128sample s;
+  for (int i = 1; i <= ACE128_QUEUE; i++)
+  {
+    ACE128SIM_CHECK(knob.readQueue(s) && s.mpos == 20 * i);
+  }
+  ACE128SIM_CHECK(!knob.readQueue(s));
+  ACE128SIM_CHECK(knob.mpos() == 20000);
+  // and counts on from there
+  shaft.turn(-50);
+  knob.isrSample();
+  ACE128SIM_CHECK(knob.readQueue(s) && s.mpos == 19950);
+  ACE128SIM_CHECK(!knob.readQueue(s));
+  ACE128SIM_CHECK(knob.mpos() == 19950);
+}
+
+#ifdef ACE128_RECOVER
+// isrSample() and loop() each recover from their own last good position
+void testRecover()
+{
+  ACE128sim.attach(0x20, codes);
+  int tried = 0;
+  for (uint16_t bad = 0; bad < 256; bad++)
+  {
+    if (encoderMap_87654321[bad] != 0xFF) continue;
+    // two good codes a bit away, far enough apart on the knob that recovery has to pick between them
+    uint8_t near1 = 0xFF;
+    uint8_t near2 = 0xFF;
+    for (uint8_t i = 0; i <= 7; i++)
+    {
+      uint8_t raw = encoderMap_87654321[bad ^ (1 << i)];
+      if (raw == 0xFF) continue;
+      if (near1 == 0xFF) near1 = raw;
+      else if (((raw - near1) & 0x7F) > 16 && ((near1 - raw) & 0x7F) > 16) near2 = raw;
+    }
+    if (near2 == 0xFF) continue;
+    tried++;
+    ACE128 knob(0x20, MAP);
+    codes.pins = codeFor(near1);
+    knob.begin();
+    ACE128SIM_CHECK(knob.rawPos() == near1);       // loop() last saw near1
+    codes.pins = codeFor(near2);
+    knob.isrSample();                               // isrSample() last saw near2
+    codes.pins = bad;
+    ACE128SIM_CHECK(knob.rawPos() == near1);
+    knob.isrSample();
+    ACE128sample s;
+    ACE128SIM_CHECK(knob.readQueue(s) && s.raw == near2);
+    ACE128SIM_CHECK(knob.readQueue(s) && s.raw == near2);
+  }
+  ACE128SIM_CHECK(tried > 0);
+  ACE128sim.attach(0x20, chip);
+}
+#endif
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  testQueue();
+  testOverflow();
+#ifdef ACE128_RECOVER
+  testRecover();
+#endif
+  return (ACE128SIM_DONE());
+}
@@ -0,0 +1,46 @@
+/*
+  test_recover.cpp - ACE128_RECOVER on every one and two bit misread, and the lookups it takes
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_RECOVER
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+ACE128simShaft shaft;
+ACE128simPCF8574 chip(shaft);
+ACE128 knob(0x20, (uint8_t *)encoderMap_87654321);
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  knob.begin();
+  unsigned long worst[3] = { 0, 0, 0 };
+  for (uint8_t raw = 0; raw < 128; raw++)
+  {
+    shaft.set(raw);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      for (uint8_t j = i; j < 8; j++)
+      {
+        uint8_t mask = (1 << i) | (1 << j);
+        shaft.noise(0);
+        ACE128SIM_CHECK(knob.rawPos() == raw && knob.decodeError() == 0);
+        shaft.noise(mask);
+        if (encoderMap_87654321[shaft.pins()] != 0xFF) continue;  // misread as another position - can't tell
+        ACE128sim.reset();
+        uint8_t got = knob.rawPos();
+        uint8_t dist = (i == j) ? 1 : 2;
+        if (ACE128sim.pgmReads > worst[dist]) worst[dist] = ACE128sim.pgmReads;
+        ACE128SIM_CHECK(knob.decodeError() != 0xFF && knob.decodeError() <= dist);
+        if (dist == 1) ACE128SIM_CHECK(((got - raw) & 0x7F) <= 1 || ((raw - got) & 0x7F) <= 1);
+      }
+    }
+  }
+  // the read itself, then at most 8 codes one bit away and 28 two bits away
+  ACE128SIM_CHECK(worst[1] <= 1 + 8);
+  ACE128SIM_CHECK(worst[2] <= 1 + 8 + 28);
+  printf("lookups per recovery, worst case: one bit %lu, two bits %lu\n", worst[1], worst[2]);
+  return (ACE128SIM_DONE());
+}
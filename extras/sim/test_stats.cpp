@@ -0,0 +1,152 @@
+/*
+  test_stats.cpp - ACE128_STATS counters and read time histogram against known reads, rollovers and bus errors
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_STATS
+#include <ACE128.h>
+#include <ACE128group.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+const uint8_t KNOBS = 3;
+ACE128simShaft shafts[KNOBS];
+ACE128simPCF8574 pcf0(shafts[0]);
+ACE128simPCF8574 pcf1(shafts[1]);
+#ifdef ACE128_MCP23008
+ACE128simMCP23008 chip2(shafts[2]);
+ACE128 knobs[KNOBS] = { ACE128(0x20, MAP), ACE128(0x21, MAP), ACE128(0x02, MAP) };
+#else
+ACE128simPCF8574 chip2(shafts[2]);
+ACE128 knobs[KNOBS] = { ACE128(0x20, MAP), ACE128(0x21, MAP), ACE128(0x22, MAP) };
+#endif
+
+// the histogram bucket of a read taking us
+uint8_t bucketFor(unsigned long us)
+{
+  uint8_t bucket = 0;
+  for (; us > 0 && bucket < ACE128_STATS_BUCKETS - 1; us >>= 1) bucket++;
+  return (bucket);
+}
+
+// how long one read of an expander takes on the sim bus - address and a data byte
+unsigned long readUs(uint32_t clock)
+{
+  return (2UL * 9 * 1000000UL / clock + 10);
+}
+
+bool histogram(const ACE128stats &s, uint8_t bucket, uint16_t reads)
+{
+  for (uint8_t b = 0; b < ACE128_STATS_BUCKETS; b++)
+  {
+    if (s.latency[b] != (b == bucket ? reads : 0)) return (false);
+  }
+  return (true);
+}
+
+void testKnob()
+{
+  ACE128 &knob = knobs[0];
+  ACE128stats s = knob.stats();
+  ACE128SIM_CHECK(s.reads > 0);                    // begin() read the knob
+  knob.resetStats();
+  s = knob.stats();
+  ACE128SIM_CHECK(s.reads == 0 && s.busErrors == 0 && s.invalid == 0 && s.rollovers == 0 && s.eepromWrites == 0);
+  ACE128SIM_CHECK(histogram(s, 0, 0));
+
+  // 500 reads 10 steps apart - a rollover each time pos() wraps from 63 to -64
+  Wire.setClock(100000);
+  uint16_t rollovers = 0;
+  for (int i = 1; i <= 500; i++)
+  {
+    shafts[0].turn(10);
+    ACE128SIM_CHECK(knob.mpos() == 10 * i);
+    if ((10 * i + 64) / 128 != (10 * (i - 1) + 64) / 128) rollovers++;
+  }
+  s = knob.stats();
+  ACE128SIM_CHECK(rollovers == 39);
+  ACE128SIM_CHECK(s.reads == 500 && s.rollovers == rollovers && s.busErrors == 0 && s.invalid == 0);
+  ACE128SIM_CHECK(histogram(s, bucketFor(readUs(100000)), 500));
+
+  // 7 reads with nobody at the address are 7 bus errors, and decoded, the 0xFF such a read gives is not a valid code
+  knob.resetStats();
+  ACE128sim.detach(0x20);
+  for (int i = 0; i < 7; i++) knob.acePins();
+  ACE128sim.attach(0x20, pcf0);
+  s = knob.stats();
+  ACE128SIM_CHECK(s.reads == 7 && s.busErrors == 7 && s.invalid == 0);
+  knob.rawPos();
+  ACE128sim.detach(0x20);
+  knob.rawPos();
+  ACE128sim.attach(0x20, pcf0);
+  s = knob.stats();
+  ACE128SIM_CHECK(s.reads == 9 && s.busErrors == 8 && s.invalid == 1);
+
+  // a faster bus moves the reads down the histogram
+  knob.resetStats();
+  Wire.setClock(400000);
+  for (int i = 0; i < 30; i++) knob.mpos();
+  Wire.setClock(100000);
+  for (int i = 0; i < 20; i++) knob.mpos();
+  s = knob.stats();
+  ACE128SIM_CHECK(bucketFor(readUs(400000)) != bucketFor(readUs(100000)));
+  ACE128SIM_CHECK(s.latency[bucketFor(readUs(400000))] == 30 && s.latency[bucketFor(readUs(100000))] == 20);
+  ACE128SIM_CHECK(s.reads == 50);
+
+  // counters stop at 65535
+  knob.resetStats();
+  for (long i = 0; i < 70000L; i++) knob.acePins();
+  s = knob.stats();
+  ACE128SIM_CHECK(s.reads == 0xFFFF && s.latency[bucketFor(readUs(100000))] == 0xFFFF);
+}
+
+void testGroup()
+{
+  ACE128group panel;
+  for (uint8_t i = 0; i < KNOBS; i++) panel.add(knobs[i]);
+  panel.begin(100000);
+  panel.resetStats();
+  ACE128stats s = panel.stats();
+  ACE128SIM_CHECK(s.reads == 0 && s.rollovers == 0 && s.busErrors == 0);
+  for (int step = 1; step <= 100; step++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++) shafts[i].turn(i + 1);   // 100, 200 and 300 steps
+    if (step == 50) ACE128sim.detach(0x21);
+    if (step == 53) ACE128sim.attach(0x21, pcf1);
+    panel.scan();
+  }
+  s = panel.stats();
+  uint16_t reads = 0, rollovers = 0, busErrors = 0;
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    ACE128stats k = knobs[i].stats();
+    reads += k.reads;
+    rollovers += k.rollovers;
+    busErrors += k.busErrors;
+    ACE128SIM_CHECK(k.reads == 100);
+  }
+  ACE128SIM_CHECK(s.reads == 3 * 100 && s.reads == reads);
+  ACE128SIM_CHECK(s.busErrors == 3 && s.busErrors == busErrors);
+  ACE128SIM_CHECK(s.rollovers == rollovers && rollovers >= 3);
+  ACE128SIM_CHECK(histogram(s, bucketFor(readUs(100000)), 300));
+  // the sums stop at 65535 as well
+  for (long i = 0; i < 30000L; i++) knobs[0].acePins();
+  for (long i = 0; i < 30000L; i++) knobs[1].acePins();
+  for (long i = 0; i < 30000L; i++) knobs[2].acePins();
+  ACE128SIM_CHECK(panel.stats().reads == 0xFFFF);
+  panel.resetStats();
+  for (uint8_t i = 0; i < KNOBS; i++) ACE128SIM_CHECK(knobs[i].stats().reads == 0);
+  ACE128SIM_CHECK(panel.stats().reads == 0);
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, pcf0);
+  ACE128sim.attach(0x21, pcf1);
+  ACE128sim.attach(0x22, chip2);
+  for (uint8_t i = 0; i < KNOBS; i++) knobs[i].begin();
+  testKnob();
+  testGroup();
+  return (ACE128SIM_DONE());
+}
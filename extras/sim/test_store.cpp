@@ -0,0 +1,121 @@
+/*
+  test_store.cpp - ACE128store saving and restoring a panel, and isrSample() counting on from the restored state,
+  and restoring again later, with the knob moved since begin()
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_QUEUE 8
+#include <ACE128.h>
+#include <ACE128store.h>
+#include <ACE128map87654321.h>
+
+const uint8_t KNOBS = 12;          // more than one page
+ACE128simShaft shafts[KNOBS];
+ACE128simPCF8574 *chips[KNOBS];
+ACE128simEEPROM eeprom;
+
+// knobs 0 - 7 on PCF8574s, 8 - 11 on PCF8574As, as a fresh power up sees them
+void panel(int16_t *mpos)
+{
+  ACE128 *knobs[KNOBS];
+  ACE128store store(64);
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    knobs[i] = new ACE128((i < 8 ? 0x20 : 0x38 - 8) + i, (uint8_t *)encoderMap_87654321);
+    store.add(*knobs[i]);
+    knobs[i]->begin();
+  }
+  store.begin();
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    ACE128SIM_CHECK(knobs[i]->mpos() == mpos[i]);
+    // the queue counts on from the restored position too
+    shafts[i].turn(3);
+    knobs[i]->isrSample();
+    ACE128sample s;
+    ACE128SIM_CHECK(knobs[i]->readQueue(s) && s.mpos == mpos[i] + 3);
+    ACE128SIM_CHECK(knobs[i]->mpos() == mpos[i] + 3);
+    mpos[i] += 3;
+  }
+  // turn them all a way and save
+  for (int step = 0; step < 1000; step++)
+  {
+    for (uint8_t i = 0; i < KNOBS; i++)
+    {
+      shafts[i].turn(i % 2 ? 1 : -1);
+      knobs[i]->mpos();
+      store.update();
+      ACE128sim.advance(100);
+    }
+  }
+  store.flush();
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    mpos[i] += (i % 2 ? 1000 : -1000);
+    ACE128SIM_CHECK(knobs[i]->mpos() == mpos[i]);
+    delete knobs[i];
+  }
+}
+
+// store.begin() again long after knob.begin() - it reads where the knob is rather than trusting begin() put zero
+// there, so a move across the half turn straight after still counts as one
+void testAgain()
+{
+  ACE128simShaft shaft;
+  ACE128simPCF8574 chip(shaft);
+  ACE128sim.attach(0x3C, chip);
+  ACE128 knob(0x3C, (uint8_t *)encoderMap_87654321);
+  ACE128store store(256);
+  store.add(knob);
+  knob.begin();
+  store.begin();                   // blank
+  for (int i = 1; i <= 20; i++)
+  {
+    shaft.turn(-10);
+    ACE128SIM_CHECK(knob.mpos() == -10 * i);
+  }
+  store.flush();                   // two turns down, at 56
+  for (int i = 1; i <= 26; i++)
+  {
+    shaft.turn(10);
+    knob.mpos();
+  }
+  shaft.turn(2);
+  ACE128SIM_CHECK(knob.mpos() == 62);   // 2 short of half a turn
+  store.begin();                   // back to the saved turn count, with the knob at 62
+  ACE128SIM_CHECK(knob.getZero() == 0);
+  shaft.turn(3);
+  ACE128SIM_CHECK(knob.mpos() == -256 + 65);
+  shaft.turn(-3);
+  store.begin();
+  shaft.turn(3);
+  knob.isrSample();
+  ACE128sample s;
+  ACE128SIM_CHECK(knob.readQueue(s) && s.mpos == -256 + 65);
+  ACE128sim.detach(0x3C);
+}
+
+int main()
+{
+  eeprom.writeCycle = 5000;
+  ACE128sim.attach(0x50, eeprom);
+  int16_t mpos[KNOBS];
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    chips[i] = new ACE128simPCF8574(shafts[i]);
+    ACE128sim.attach((i < 8 ? 0x20 : 0x38 - 8) + i, *chips[i]);
+    shafts[i].set(i * 10);
+    mpos[i] = 0;
+  }
+  panel(mpos);                     // blank EEPROM - everything starts at 0
+  panel(mpos);                     // restored
+  for (uint8_t i = 0; i < KNOBS; i++)
+  {
+    shafts[i].turn(1);             // not far enough to leave the half turn either side of zero
+    mpos[i]++;
+  }
+  panel(mpos);                     // restored after turning with the power off
+  testAgain();
+  return (ACE128SIM_DONE());
+}
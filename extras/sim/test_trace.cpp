@@ -0,0 +1,159 @@
+/*
+  test_trace.cpp - ACE128_TRACE round trip: record a sweep with setTrace(), replay it with ACE128replay, compare
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_TRACE
+#include <ACE128.h>
+#include <ACE128trace.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+const unsigned long MAX_SAMPLES = 20000;
+
+ACE128simShaft shaft;
+ACE128simPCF8574 chip(shaft);
+
+// a Print into memory
+class Recorder : public Print
+{
+  public:
+    uint8_t data[65536];
+    size_t len;
+    Recorder() : len(0) {}
+    size_t write(uint8_t b)
+    {
+      if (len >= sizeof(data)) return (0);
+      data[len++] = b;
+      return (1);
+    }
+};
+Recorder trace;
+
+// what the recording knob read, and what the replay made of it
+struct Seen
+{
+  int16_t mpos;
+  uint8_t pins;
+};
+Seen recorded[MAX_SAMPLES];
+Seen replayed[MAX_SAMPLES];
+unsigned long nRecorded = 0;
+unsigned long nReplayed = 0;
+
+void onSample(const ACE128sample &s)
+{
+  if (nReplayed < MAX_SAMPLES)
+  {
+    replayed[nReplayed].mpos = s.mpos;
+    replayed[nReplayed].pins = s.pins;
+  }
+  nReplayed++;
+}
+
+// read the knob the way a sketch would, a ms apart
+void read(ACE128 &knob, bool useSample)
+{
+  ACE128sim.advance(1000);
+  Seen &r = recorded[nRecorded < MAX_SAMPLES ? nRecorded : MAX_SAMPLES - 1];
+  if (useSample)
+  {
+    ACE128sample s = knob.sample();
+    r.mpos = s.mpos;
+    r.pins = s.pins;
+  }
+  else
+  {
+    r.mpos = knob.mpos();
+    r.pins = shaft.pins();
+  }
+  nRecorded++;
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  shaft.set(37);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  knob.setMpos(-300);                  // recording starts mid count
+  read(knob, false);                   // not traced
+  nRecorded = 0;
+  knob.setTrace(&trace);
+  // a slow sweep up through two turns, a read a step
+  for (int i = 0; i < 300; i++)
+  {
+    shaft.turn(1);
+    read(knob, i % 2);
+  }
+  // idle runs - short, the longest a run byte holds, longer, and a long gap between reads
+  for (int i = 0; i < 10; i++) read(knob, true);
+  shaft.turn(-1);
+  for (int i = 0; i < 64; i++) read(knob, false);
+  shaft.turn(-1);
+  for (int i = 0; i < 5000; i++) read(knob, true);
+  ACE128sim.advance(3000000);
+  shaft.turn(2);
+  read(knob, true);
+  // back down fast, a few steps a read
+  for (int i = 0; i < 200; i++)
+  {
+    shaft.turn(-7);
+    read(knob, false);
+  }
+  // zero moved, then reversed, then the count set, all mid trace
+  knob.setZero();
+  for (int i = 0; i < 100; i++)
+  {
+    shaft.turn(3);
+    read(knob, true);
+  }
+  knob.reverse(true);
+  for (int i = 0; i < 100; i++)
+  {
+    shaft.turn(5);
+    read(knob, true);
+  }
+  knob.setMpos(1000);
+  for (int i = 0; i < 100; i++)
+  {
+    shaft.turn(-2);
+    read(knob, false);
+  }
+#ifdef ACE128_RECOVER
+  // a dirty contact - the replay recovers the same positions
+  shaft.noise(0x10);
+  for (int i = 0; i < 50; i++)
+  {
+    shaft.turn(1);
+    read(knob, true);
+  }
+  shaft.noise(0);
+#endif
+  for (int i = 0; i < 20; i++) read(knob, true);
+  knob.setTrace(NULL);                 // finishes the last run
+  read(knob, true);                    // not traced
+  nRecorded--;
+  ACE128SIM_CHECK(nRecorded < MAX_SAMPLES);
+  ACE128SIM_CHECK(trace.len < nRecorded);  // idle runs cost next to nothing
+
+  ACE128 player(0x20, MAP);            // never begin()'d - the trace sets it up
+  ACE128replay replay(player, onSample);
+  bool ok = true;
+  for (size_t i = 0; i < trace.len; i++) ok = ok && replay.put(trace.data[i]);
+  ACE128SIM_CHECK(ok);
+  ACE128SIM_CHECK(nReplayed == nRecorded);
+  ACE128SIM_CHECK(replay.samples() == nRecorded);
+  unsigned long bad = 0;
+  for (unsigned long i = 0; i < nRecorded && i < nReplayed; i++)
+  {
+    if (replayed[i].mpos != recorded[i].mpos || replayed[i].pins != recorded[i].pins) bad++;
+  }
+  ACE128SIM_CHECK(bad == 0);
+  ACE128SIM_CHECK(replay.last().mpos == recorded[nRecorded - 1].mpos);
+  // a broken trace stops the replay
+  ACE128replay broken(player);
+  ACE128SIM_CHECK(broken.put('A') && !broken.put('X') && !broken.put('C'));
+  return (ACE128SIM_DONE());
+}
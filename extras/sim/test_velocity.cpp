@@ -0,0 +1,70 @@
+/*
+  test_velocity.cpp - ACE128_VELOCITY velocity(), acceleration() and predict() on a knob at steady and ramped speeds
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+*/
+
+#define ACE128_VELOCITY 8
+#include <ACE128.h>
+#include <ACE128map87654321.h>
+
+#define MAP ((uint8_t *)encoderMap_87654321)
+
+ACE128simShaft shaft;
+ACE128simPCF8574 chip(shaft);
+
+int absdiff(double a, double b)
+{
+  return ((int)(a > b ? a - b + 0.5 : b - a + 0.5));
+}
+
+// v0 steps per second at the start, accelerating at a steps per second per second, read every period us
+// for a second, then the estimates are checked against the true motion at the last read
+void run(double v0, double a, unsigned long period)
+{
+  shaft.set(0);
+  ACE128 knob(0x20, MAP);
+  knob.begin();
+  unsigned long start = ACE128sim.us;
+  long steps = 0;
+  double t = 0;
+  while (ACE128sim.us - start < 1000000UL)
+  {
+    t = (ACE128sim.us - start) / 1e6;
+    long at = (long)(v0 * t + a * t * t / 2);
+    shaft.turn((int16_t)(at - steps));
+    steps = at;
+    ACE128SIM_CHECK(knob.mpos() == steps);
+    ACE128sim.advance(period);
+  }
+  double v = v0 + a * t;
+  double then = (ACE128sim.us - start) / 1e6 + 0.1;
+  double later = v0 * then + a * then * then / 2;
+  // whole steps and whole ms over a ring of about 150 ms leave the acceleration a couple of hundred steps/s^2 out
+  // at worst, and the speed, which is moved on to the newest sample with it, a few tens of steps/s. That sample
+  // can be up to ACE128_VELOCITY_MS before the last read
+  double lag = (a < 0 ? -a : a) * ACE128_VELOCITY_MS / 1000;
+  ACE128SIM_CHECK(absdiff(knob.velocity(), v) <= 25 + lag + (v < 0 ? -v : v) / 100);
+  if (a == 0) ACE128SIM_CHECK(knob.acceleration() == 0);
+  else ACE128SIM_CHECK(absdiff(knob.acceleration(), a) <= 300);
+  ACE128SIM_CHECK(absdiff(knob.predict(100), later) <= 5);
+}
+
+int main()
+{
+  ACE128sim.attach(0x20, chip);
+  const unsigned long periods[5] = { 1000, 3000, 5000, 7000, 11000 };
+  for (uint8_t p = 0; p < 5; p++)
+  {
+    // steady
+    run(1536, 0, periods[p]);        // 12 rev/s
+    run(200, 0, periods[p]);
+    run(-800, 0, periods[p]);
+    run(20, 0, periods[p]);
+    // ramped
+    run(0, 1000, periods[p]);
+    run(500, -1000, periods[p]);
+    run(-300, -2000, periods[p]);
+  }
+  return (ACE128SIM_DONE());
+}
@@ -23,15 +23,111 @@
 // #define ACE128_EEPROM_I2C  // I2C EEPROM - e.g.  Microchip 24CW160T
 // #define ACE128_EEPROM_ADDR 0x50  // address for the I2C chip. If you leave this undefined it defaults to 0x50
 
+// Journal the EEPROM state to spread wear and cut writes. Each save goes to the next of a ring of
+// 4 byte records, and multiturn changes are held back until the knob has been idle for a while.
+// Each encoder then needs ACE128_EEPROM_JOURNAL * 4 bytes of EEPROM starting at eeAddr.
+// Keep eeAddr a multiple of 4 on I2C EEPROMs so records don't straddle a page.
+// The journal format is not compatible with the plain 3 byte format.
+// #define ACE128_EEPROM_JOURNAL 8       // number of records in the ring, 1 - 254
+// #define ACE128_EEPROM_IDLE_MS 2000    // save once the turn count has been still this long
+// #define ACE128_EEPROM_MAX_MS  60000   // but save at least this often while it keeps changing
+
 // Enable MCP23008 support. 
 // Before v2.0.0 this was available by default. Now you need to set this flag.
 // #define ACE128_MCP23008 // Enable MCP23008 support
 
+// Enable 16 bit expanders - MCP23017, PCA9555 and PCF8575 - with an encoder on each 8 bit port.
+// Construct an ACE128expander16 for the chip and pass it to the constructors of its two encoders.
+// Reading one encoder fetches both ports in one transaction, and the other encoder's next read uses that, as long
+// as it comes within ACE128_EXPANDER16_MS - read the pair back to back. Later than that it goes to the bus again.
+// #define ACE128_EXPANDER16
+// #define ACE128_EXPANDER16_MS 2       // how long the other port's byte stays good
+
+// Decode without a 256 byte map table per wiring, for flash-tight parts. Pass an 8 byte PROGMEM pin order instead of
+// a map - the ACE-128 pin on expander P0 to P7, e.g. ACE128map<8,7,6,5,4,3,2,1>::order from ACE128map.h.
+// All wirings then share one 32 byte table. A decode takes a few hundred cycles instead of a few.
+// encoderMap_12348765R is not a plain pin order, so it has no equivalent.
+// #define ACE128_COMPACT_MAP
+
+// Allow maps (or pin orders with ACE128_COMPACT_MAP) in RAM as well as PROGMEM - e.g. one built at startup by
+// ACE128calibrate. setMap(map, true) says an encoder's map is in RAM, the rest stay in PROGMEM.
+// Costs a byte of RAM per encoder. ACE128bank still wants PROGMEM maps.
+// #define ACE128_RAM_MAP
+
 // Use direct pin connection, disable pin expander code
 // Also disables all I2C activity unless ACE128_EEPROM_I2C is defined
 // Prior to v2.0.0 this was available by default along with the pin expanders
 // #define ACE128_ARDUINO_PINS
 
+// Only read the pin expander when it says something changed.
+// Wire the expander INT output to an Arduino pin and call setIntPin() before begin().
+// Several expanders can share one INT pin. Not available with ACE128_ARDUINO_PINS
+// #define ACE128_INTERRUPT
+
+// Recover from invalid codes (torn reads, contact bounce, bus noise) instead of returning 255 from rawPos().
+// An invalid code is resolved to the valid code one or two bits away that is nearest the last good position.
+// If there is none, the last good position is returned. decodeError() says what happened on the last read.
+// #define ACE128_RECOVER
+
+// Estimate knob speed and acceleration from a ring of recent (time, mpos) samples, kept by mpos() and sample().
+// Integer maths only. A sample is kept at most every ACE128_VELOCITY_MS, so the estimate covers about
+// ACE128_VELOCITY * ACE128_VELOCITY_MS milliseconds, as long as you read at least that often.
+// #define ACE128_VELOCITY 8            // number of samples in the ring, 4 - 16
+// #define ACE128_VELOCITY_MS 20        // minimum spacing of samples
+
+// Watch how far the knob moves between multiturn updates. mpos() can only tell which way the knob went if it moved
+// less than half a turn since the last call. ambiguous() flags updates that came close to that, pollInterval() says
+// how often to read at the current speed, and due() is a ready made scheduler: read when it says so and it polls
+// fast while the knob spins and backs off while it is idle.
+// #define ACE128_POLL
+// #define ACE128_POLL_MIN_MS 2         // fastest due() will ask for
+// #define ACE128_POLL_MAX_MS 50        // slowest due() will back off to when idle
+
+// Sample in the background. Call isrSample() at a steady rate from a timer interrupt, and drain the samples with
+// readQueue() from loop(). Multiturn counting is done in isrSample(), so long jobs in loop() can't lose turns.
+// Samples that don't fit in the queue are counted by queueOverflows(), not silently lost, and once readQueue() has
+// drained the queue it brings mpos back up to isrSample()'s count.
+// While isrSample() is running, read the knob only through readQueue() - mpos(), sample() and the rest decode on
+// the loop() side and would race isrSample() for the ACE128_STATS counters. ACE128_RECOVER keeps its last good
+// position apart for each side, and decodeError() is whichever decoded last.
+// On AVR the Wire library can't be used inside an interrupt, so there call isrSample() from an interrupt only
+// with ACE128_ARDUINO_PINS. I2C users can still call it from any regular task that runs more often than loop().
+// #define ACE128_QUEUE 8               // queue length, a power of 2 up to 128
+
+// Split reads into startRead(), poll() and result() so several encoders can be read without the CPU waiting on the bus.
+// On AVR the pin expander read runs on the TWI hardware directly, a step per poll(), and the CPU is free in between.
+// Reads started on several encoders take the bus in turn, so poll every one of them until it is done.
+// Elsewhere startRead() does a normal blocking Wire read and poll() is true straight away.
+// #define ACE128_ASYNC
+
+// Put pin expanders behind a TCA9548A I2C multiplexer, so each of its 8 channels can carry a full set of expander
+// addresses. Call setMux(channel) before begin(). Encoders left at -1 are on the main bus and their addresses
+// must not be used on any channel. ACE128group reads its encoders channel by channel to keep switching down.
+// Not available with ACE128_ARDUINO_PINS
+// #define ACE128_MUX
+// #define ACE128_MUX_ADDR 0x70  // address of the multiplexer. If you leave this undefined it defaults to 0x70
+
+// Count what each encoder gets up to - reads, bus errors, invalid codes, rollovers and EEPROM writes - along with a
+// histogram of read times in microseconds, in power of 2 buckets. stats() hands out a copy, resetStats() clears them.
+// Counters stop at 65535 rather than wrap. Costs 10 + 2 * ACE128_STATS_BUCKETS bytes of RAM per encoder and two
+// micros() calls per read. Left undefined, none of it is compiled.
+// #define ACE128_STATS
+// #define ACE128_STATS_BUCKETS 12      // histogram buckets, the last one holds reads of 2^(n-2) us and over
+
+// Record every sample mpos(), sample(), result() and readQueue() decode to a Print - Serial, an SD card file - in a
+// compact binary format, 2 bytes per change and a few bytes per idle stretch. setTrace(&Serial) starts a trace and
+// setTrace(NULL) ends it. Play it back through the same decoding with ACE128replay from ACE128trace.h, which also
+// describes the format. extras/linux/ace128replay.cpp does that on a desktop.
+// #define ACE128_TRACE
+
+// Raise events instead of having the sketch compare each position with the last. Every read that updates the turn count -
+// mpos(), sample(), result(), readQueue(), an ACE128group scan - looks for a move to a new detent, a change of direction
+// and a new turn, and passes them to the handler set with onEvent(), or queues them for readEvent() if there is none.
+// setDetents(n, h) counts n detents a turn, moving on only once the knob is h steps past a boundary, so a knob resting
+// on a boundary can't set off a stream of events. The default is 128 detents and no hysteresis - every step.
+// #define ACE128_EVENTS
+// #define ACE128_EVENTS_QUEUE 4        // events held for readEvent(), a power of 2 up to 128
+
 // end of user configurable #define statements
 
 // ensure mutual exclusion and defaults
@@ -50,14 +146,69 @@
   #define ACE128_EEPROM_NONE
 #endif
 
+#if defined(ACE128_EEPROM_NONE)
+  #undef ACE128_EEPROM_JOURNAL
+#elif defined(ACE128_EEPROM_JOURNAL)
+  #if !defined(ACE128_EEPROM_IDLE_MS)
+    #define ACE128_EEPROM_IDLE_MS 2000
+  #endif
+  #if !defined(ACE128_EEPROM_MAX_MS)
+    #define ACE128_EEPROM_MAX_MS 60000
+  #endif
+#endif
+
 #if defined(ACE128_EEPROM_I2C) || !defined(ACE128_ARDUINO_PINS)
   #define ACE128_I2C
 #endif
 
+#if defined(ACE128_VELOCITY) && !defined(ACE128_VELOCITY_MS)
+  #define ACE128_VELOCITY_MS 20
+#endif
+
+#if defined(ACE128_POLL)
+  #if !defined(ACE128_POLL_MIN_MS)
+    #define ACE128_POLL_MIN_MS 2
+  #endif
+  #if !defined(ACE128_POLL_MAX_MS)
+    #define ACE128_POLL_MAX_MS 50
+  #endif
+#endif
+
+#if defined(ACE128_MUX) && !defined(ACE128_MUX_ADDR)
+  #define ACE128_MUX_ADDR 0x70
+#endif
+
+#if defined(ACE128_EVENTS) && !defined(ACE128_EVENTS_QUEUE)
+  #define ACE128_EVENTS_QUEUE 4
+#endif
+
+#if defined(ACE128_STATS)
+  #if !defined(ACE128_STATS_BUCKETS)
+    #define ACE128_STATS_BUCKETS 12
+  #endif
+  #define ACE128_COUNT(counter) _statsInc(_stats.counter)
+#else
+  #define ACE128_COUNT(counter) ((void)0)
+#endif
+
+#if defined(ACE128_EXPANDER16) && !defined(ACE128_EXPANDER16_MS)
+  #define ACE128_EXPANDER16_MS 2
+#endif
+
+#if defined(ACE128_ARDUINO_PINS)
+  #undef ACE128_INTERRUPT
+  #undef ACE128_MUX
+  #undef ACE128_EXPANDER16
+  #if defined(ARDUINO_ARCH_AVR)
+    #define ACE128_FAST_PINS  // read whole port registers instead of digitalRead() per pin
+  #endif
+#endif
+
 // include types & constants of Wiring core API
 #include <Arduino.h>
 #ifdef ACE128_I2C
   #include <Wire.h>
+  #include "ACE128wire.h"
 #endif
 
 // Select EEPROM stuff, if any
@@ -69,7 +220,125 @@
   #endif
 #endif 
 // we store the encoder maps in program space
-#include <avr/pgmspace.h>
+// most cores already pull this in via Arduino.h - only include it if they didn't, so that
+// cores and off-target builds without an avr/ directory can supply pgm_read_byte themselves
+#ifndef pgm_read_byte
+  #include <avr/pgmspace.h>
+#endif
+
+#if defined(ACE128_ASYNC) && !defined(ACE128_ARDUINO_PINS) && defined(TWCR)
+  #define ACE128_ASYNC_TWI  // the core gives us the AVR TWI registers
+  #define ACE128_ASYNC_TIMEOUT_MS 10  // give up on a stuck bus and fall back to Wire
+#endif
+
+// one read of the encoder in all its forms - see ACE128::sample()
+struct ACE128sample
+{
+  unsigned long ms;              // millis() when the pins were read
+  int16_t mpos;                  // multiturn position -32768 -> +32767
+  uint8_t pins;                  // gray code inputs
+  uint8_t raw;                   // raw mechanical position
+  uint8_t upos;                  // logical position 0 -> 127
+  int8_t pos;                    // logical position -64 -> +63
+};
+
+// position arithmetic shared by ACE128 and ACE128bank
+struct ACE128math
+{
+  // raw position to pos() -64 -> +63 for the given logical zero and direction
+  static int8_t raw2pos(uint8_t raw, uint8_t zero, boolean reverse)
+  {
+    int8_t pos = raw - zero;     // adjust for logical zero
+    if (reverse) pos *= -1;      // reverse direction
+    // 7bit signed numbers need to copy their neg bit to the 8bit position
+    return ((pos & 0x40) ? (pos | 0x80) : (pos & 0x7F));
+  }
+  // change in multiturn offset going from lastpos to pos
+  static int16_t rollover(int8_t lastpos, int8_t pos)
+  {
+    if ((int16_t)lastpos - pos > 0x40)       // more than half a turn smaller - we rolled up
+    {
+      return (0x80);
+    }
+    else if ((int16_t)pos - lastpos > 0x40)  // more than half a turn bigger - we rolled down
+    {
+      return (-0x80);
+    }
+    return (0);
+  }
+  // for setMpos(): the zero that puts raw position raw at mPos, and the multiturn offset once pos is read there
+  static uint8_t zeroFor(uint8_t raw, int16_t mPos)
+  {
+    return ((raw - (uint8_t)(mPos & 0x7f)) & 0x7f);  // mask to 7bit
+  }
+  static int16_t turnsFor(int16_t mPos, int8_t pos)
+  {
+    return ((mPos - pos) & 0xFF80);            // mask higher 9 bits
+  }
+};
+
+#ifdef ACE128_FAST_PINS
+// 8 Arduino pins read as one byte straight from their PINx registers, for ACE128_FAST_PINS.
+// Both registers are sampled with interrupts off, so a moving shaft can't give us half of one code and half
+// of the next. Pins spread over more than two ports leave port[0] NULL and need digitalRead() instead.
+struct ACE128ports
+{
+  volatile uint8_t *port[2];     // PINx registers holding our pins, port[0] NULL if on more than two ports
+  uint8_t bit[8];                // bit mask of each pin in its PINx register
+  uint8_t onPort1;               // bit n set if pin n is on port[1]
+  void begin(const uint8_t *pins);
+  uint8_t read();
+};
+#endif
+
+#ifdef ACE128_EVENTS
+// event types - see ACE128::onEvent()
+#define ACE128_EVENT_MOVE      1  // moved to a new detent, value is the multiturn position in detents
+#define ACE128_EVENT_TURN      2  // moved into a new turn, value is the turn number
+#define ACE128_EVENT_DIRECTION 3  // started moving the other way, value is +1 for rising, -1 for falling
+
+struct ACE128event
+{
+  uint8_t event;                 // ACE128_EVENT_ type
+  int16_t value;                 // depends on the type
+};
+#endif
+
+#ifdef ACE128_STATS
+// what an encoder has done since the last resetStats() - see ACE128::stats()
+struct ACE128stats
+{
+  uint16_t reads;                // pin reads
+  uint16_t busErrors;            // unacknowledged writes and short reads
+  uint16_t invalid;              // codes with no position in the map
+  uint16_t rollovers;            // turns counted by the multiturn position
+  uint16_t eepromWrites;         // saves that changed the EEPROM
+  uint16_t latency[ACE128_STATS_BUCKETS]; // reads by time taken - bucket 0 under 1us, bucket b 2^(b-1) to 2^b - 1us
+};
+#endif
+
+#ifdef ACE128_EXPANDER16
+// a 16 bit expander shared by two encoders, see the ACE128 constructors that take one
+class ACE128expander16
+{
+  public:
+    ACE128expander16(uint8_t i2caddr, uint8_t chip); // address 0x20 - 0x27, chip ACE128_CHIP_MCP23017, _PCA9555 or _PCF8575
+  private:
+    friend class ACE128;
+    int _i2caddr;                  // chip address
+    uint8_t _chip;                 // chip type
+    boolean _begun;                // set up by the first of its encoders to begin()
+    boolean _parked;               // register pointer is on the input ports
+    uint8_t _pins[2];              // both ports from the last read
+    uint8_t _fresh;                // bit per port - read from the bus but not yet handed out
+    uint16_t _readMs;              // low 16 bits of millis() at the last bus read
+#ifdef ACE128_STATS
+    uint8_t _errors;               // bus errors not yet passed on to an encoder
+#endif
+    void _begin();
+    uint8_t _read(uint8_t port);
+};
+#endif
 
 // library interface description
 class ACE128
@@ -95,11 +364,19 @@ class ACE128
     ACE128(uint8_t i2caddr, uint8_t *map, int16_t eeAddr);
   #endif
     ACE128(uint8_t i2caddr, uint8_t *map);
+  #ifdef ACE128_EXPANDER16
+    // encoder on port 0 or 1 of a 16 bit expander - port A or B on the MCP23017
+    #ifndef ACE128_EEPROM_NONE
+    ACE128(ACE128expander16 &chip, uint8_t port, uint8_t *map, int16_t eeAddr);
+    #endif
+    ACE128(ACE128expander16 &chip, uint8_t port, uint8_t *map);
+  #endif
 #endif
     void begin();                  // initializes IO expander, call from setup()
     uint8_t upos();                // returns logical position 0 -> 127
     int8_t pos();                  // returns logical position -64 -> +63
     int16_t mpos();                // returns multiturn position -32768 -> +32767
+    ACE128sample sample();         // one read, returns all of the above plus pins and timestamp
     void setMpos(int16_t mPos);    // sets current position to multiturn value - also changes zero
     void setZero();                // sets logical zero to current position
     void setZero(uint8_t rawPos);  // sets logical zero position
@@ -107,52 +384,310 @@ class ACE128
     uint8_t rawPos();              // returns raw mechanical position
     uint8_t acePins();             // returns gray code inputs
     void reverse(boolean reverse); // set counter-clockwise operation
+#ifdef ACE128_RAM_MAP
+    void setMap(uint8_t *map, boolean ram = false); // change map table, ram true if it is in RAM not PROGMEM
+#else
+    void setMap(uint8_t *map);     // change PROGMEM map table
+#endif
+#ifdef ACE128_EEPROM_JOURNAL
+    void flush();                  // save any held back state to EEPROM now
+#endif
+#ifdef ACE128_VELOCITY
+    int16_t velocity();            // steps per second, positive for rising mpos
+    int16_t acceleration();        // steps per second per second
+    int16_t predict(uint16_t ms);  // expected mpos ms milliseconds from now, for latency compensation
+#endif
+#ifdef ACE128_ASYNC
+    void startRead();              // start reading the pins
+    boolean poll();                // move the read along, true once it has finished
+    boolean ready();               // true if the read has finished
+    ACE128sample result();         // decode the finished read like sample() does, no bus traffic
+#endif
+#ifdef ACE128_QUEUE
+    void isrSample();              // read and queue one sample - the producer, e.g. a timer interrupt
+    boolean readQueue(ACE128sample &s); // oldest queued sample, false if none - the consumer, e.g. loop()
+    uint16_t queueOverflows();     // samples dropped because the queue was full
+#endif
+#ifdef ACE128_POLL
+    boolean ambiguous();           // last multiturn update moved too far to be sure of the direction
+    uint16_t pollInterval();       // longest safe time in ms between reads at the current speed
+    boolean due();                 // time to call mpos() or sample() again
+#endif
+#ifdef ACE128_RECOVER
+    uint8_t decodeError();         // last read: 0 clean, 1 or 2 bits corrected, 255 unreadable - last good position used
+#endif
+#ifdef ACE128_INTERRUPT
+    void setIntPin(int8_t pin);    // expander INT output is wired to this pin, call before begin()
+    boolean changed();             // true if the pins may have changed since the last read
+#endif
+#ifdef ACE128_MUX
+    void setMux(int8_t channel);   // expander is on this multiplexer channel 0 - 7, -1 for the main bus. Call before begin()
+    int8_t mux();                  // channel set by setMux()
+    static unsigned long muxSwitches(); // channel switches made so far, by all encoders
+#endif
+#ifdef ACE128_STATS
+    ACE128stats stats();           // copy of the counters and read time histogram
+    void resetStats();             // clear them
+#endif
+#ifdef ACE128_TRACE
+    void setTrace(Print *out);     // start recording samples to out, NULL to finish
+#endif
+#ifdef ACE128_EVENTS
+    void setDetents(uint8_t detents, uint8_t hysteresis = 0); // detents a turn 1 - 128, steps past a boundary before moving
+    void onEvent(void (*handler)(ACE128 &encoder, uint8_t event, int16_t value)); // NULL queues events for readEvent()
+    boolean readEvent(ACE128event &e); // oldest queued event, false if none
+    int16_t detent();              // multiturn position in detents as of the last read
+#endif
     // library-accessible "private" interface
   private:
+    friend class ACE128store;      // saves and restores _mpos and _zero for many encoders at once
+    friend class ACE128group;      // starts and reads many encoders on one bus
+    friend class ACE128replay;     // plays traces back through _sample()
+    void _begin();                 // begin() without Wire.begin()
+    void _restore(uint8_t zero, int16_t mpos, uint8_t rawpos); // saved state, with the knob now at rawpos
+    ACE128sample _sample(uint8_t pins, unsigned long ms); // sample() from pins already read
+#ifdef ACE128_WIRE_BATCH
+    boolean _batchQueue(uint8_t *pins); // add our read to the Wire batch, false if it is full
+    uint8_t _batchPins(uint8_t pins);   // our pins once the batch has been sent
+#endif
+    uint8_t _readPins();           // acePins() without the statistics
     uint8_t _zero;                 // raw position of logical zero
     int8_t _reverse;               // counter-clockwise
     uint8_t *_map;                 // pointer to PROGMEM map table
+#ifdef ACE128_RAM_MAP
+    boolean _mapRam;               // _map is in RAM
+#endif
+    uint8_t _mapByte(uint8_t i);   // byte i of the map table
     int16_t _mpos;                 // multiturn offset
     int8_t _lastpos;               // last upos
 #ifndef ACE128_EEPROM_NONE
     int16_t _eeAddr;               // multiturn save location (2 bytes)
-    void _eeprom_read_settings(); // read _mpos and _zero from 
+    boolean _eeprom_read_settings(); // read _mpos and _zero from eeprom, false if nothing saved
     void _eeprom_write_mpos();    // write _mpos to eeprom
     void _eeprom_write_zero();    // write _zero to eeprom 
+#endif
+#ifdef ACE128_EEPROM_JOURNAL
+    uint8_t _eeSlot;               // ring slot of the newest record
+    uint8_t _eeSeq;                // sequence number of the newest record
+    boolean _eeDirty;              // turn count changed since the newest record
+    int16_t _eeMpos;               // _mpos when we last looked
+    unsigned long _eeChanged;      // millis() when the turn count last changed
+    unsigned long _eeWritten;      // millis() when we last wrote a record
+    void _eeprom_write_record();   // write _mpos and _zero to the next slot
+    void _eeprom_read(uint16_t addr, uint8_t *buf, uint8_t len);
 #endif
     int8_t _raw2pos(int8_t pos);   // convert rawPos() value to pos()
+    uint8_t _pins2raw(uint8_t pins); // convert acePins() value to rawPos()
+    uint8_t _lookup(uint8_t pins); // map table entry for pins
+    int16_t _mpos_update(int8_t pos, unsigned long ms); // track rollovers, convert pos() value read at ms to mpos()
+#ifdef ACE128_VELOCITY
+    uint16_t _vms[ACE128_VELOCITY]; // sample times, low 16 bits of millis()
+    int16_t _vpos[ACE128_VELOCITY]; // sample mpos
+    uint8_t _vnext;                // ring slot for the next sample
+    uint8_t _vcount;               // samples in the ring
+    void _velocity_add(int16_t mpos, uint16_t ms);
+    int32_t _velocity_fit(uint8_t skip, uint8_t n, int16_t *age); // steps/s over n samples, skipping the newest skip
+#endif
+#ifdef ACE128_ASYNC
+    uint8_t _aState;               // read state machine, see poll()
+    uint8_t _aPins;                // pins from the last finished read
+    unsigned long _aMs;            // millis() when the last read finished
+  #ifdef ACE128_ASYNC_TWI
+    static ACE128 *_aOwner;        // encoder whose read has the TWI hardware, NULL when it is free
+    uint8_t _twiAddr() { return (uint8_t)_i2caddr << 1; }  // SLA+W, or SLA+R with bit 0 set
+  #endif
+#endif
+#ifdef ACE128_QUEUE
+    struct _queued {
+      uint16_t ms;                 // low 16 bits of millis()
+      int16_t mpos;                // multiturn position as counted by isrSample()
+      uint8_t pins;                // gray code inputs
+    } _queue[ACE128_QUEUE];
+    volatile uint8_t _qhead;       // next slot to fill - only isrSample() changes it
+    volatile uint8_t _qtail;       // next slot to read - only readQueue() changes it
+    volatile uint16_t _qoverflow;  // see queueOverflows()
+    int16_t _qmpos;                // isrSample() copy of _mpos
+    int8_t _qlastpos;              // isrSample() copy of _lastpos
+    uint16_t _qseen;               // _qoverflow when readQueue() last caught up with isrSample()
+  #ifdef ACE128_RECOVER
+    uint8_t _qlastraw;             // isrSample() copy of _lastraw
+  #endif
+    void _queue_sync();            // restart isrSample() counting from _mpos and _lastpos
+    void _queue_catchup();         // bring _mpos and _lastpos up to isrSample() after dropped samples
+#endif
+#ifdef ACE128_POLL
+    uint16_t _pollms;              // low 16 bits of millis() at the last multiturn update
+    uint16_t _pollInterval;        // see pollInterval()
+    boolean _ambiguous;            // see ambiguous()
+    void _poll_update(int8_t step);
+#endif
+#ifdef ACE128_RECOVER
+    uint8_t _lastraw;              // last good raw position
+    uint8_t _decodeError;          // see decodeError()
+    uint8_t _recover(uint8_t pins); // best guess raw position for an invalid code
+#endif
 #ifdef ACE128_ARDUINO_PINS
     uint8_t _pins[8];              // store pins for direct attach mode
+  #ifdef ACE128_FAST_PINS
+    ACE128ports _ports;            // our pins' PINx registers
+  #endif
 #else
     uint8_t _chip;                 // chip type - derived from i2c address
     int _i2caddr;                  // i2c bus address
+  #ifdef ACE128_MCP23008
+    boolean _parked;               // MCP23008 register pointer is sitting on GPIO
+  #endif
 #endif
-#ifdef ACE128_EEPROM_I2C
+#if defined(ACE128_EEPROM_I2C) && !defined(ACE128_EEPROM_JOURNAL)
     int16_t _mpos_i2c;              // mpos value last seen in i2c eeprom
 #endif
+#ifdef ACE128_INTERRUPT
+    int8_t _intPin;                // pin wired to expander INT, -1 for none
+    boolean _intStale;             // _intPins must be refreshed from the bus
+    uint8_t _intPins;              // pins at last bus read
+#endif
+#ifdef ACE128_EXPANDER16
+    ACE128expander16 *_x16;        // 16 bit expander we share, NULL for an 8 bit one
+    uint8_t _x16port;              // our port on it
+#endif
+#ifdef ACE128_MUX
+    int8_t _mux;                   // multiplexer channel, -1 for the main bus
+    static uint8_t _muxOpen;       // channel bit the multiplexer has open, 0xFF if we don't know
+    static unsigned long _muxSwitches; // count of channel switches
+    void _muxSelect();             // open our channel if it isn't open already
+#endif
+#ifdef ACE128_STATS
+    ACE128stats _stats;            // see stats()
+  #ifdef ACE128_ASYNC_TWI
+    unsigned long _aUs;            // micros() at startRead()
+  #endif
+    void _statsRead(unsigned long us); // count a read that took us microseconds
+    static void _statsInc(uint16_t &counter) { if (counter != 0xFFFF) counter++; }
+#endif
+#ifdef ACE128_EVENTS
+    uint8_t _evDetents;            // detents a turn
+    uint8_t _evHysteresis;         // steps past a boundary before the detent changes
+    int16_t _evDetent;             // current detent
+    int8_t _evDir;                 // direction of the last move, 0 before the first
+    boolean _evSync;               // take the next position as it is, without events
+    void (*_evHandler)(ACE128 &encoder, uint8_t event, int16_t value);
+    ACE128event _evQueue[ACE128_EVENTS_QUEUE];
+    uint8_t _evHead;               // next slot to fill
+    uint8_t _evTail;               // next slot to read
+    void _events_update(int16_t mpos);
+    void _event(uint8_t event, int16_t value);
+    static int16_t _floorDiv(int32_t a, int16_t b);
+#endif
+#ifdef ACE128_TRACE
+    Print *_trace;                 // where the trace goes, NULL when not tracing
+    uint8_t _tPins;                // pins of the last sample written
+    uint16_t _tRun;                // repeats of _tPins not written yet
+    unsigned long _tMs;            // time of the last record written
+    unsigned long _tRunMs;         // time of the last repeat
+    void _traceSample(uint8_t pins, unsigned long ms);
+    void _traceState();            // write a state record
+    void _traceRun();              // write out held back repeats
+    void _traceVarint(unsigned long v);
+#endif
 };
 
+#ifdef ACE128_MUX
+uint8_t ACE128::_muxOpen = 0xFF;
+unsigned long ACE128::_muxSwitches = 0;
+#endif
+#ifdef ACE128_ASYNC_TWI
+ACE128 *ACE128::_aOwner = NULL;
+#endif
 
-#ifdef ACE128_MCP23008
-// MCP23008 IO expander
-  #define ACE128_MCP23008_ADDRESS 0x20
-  #define ACE128_MCP23008_IODIR   0x00
-  #define ACE128_MCP23008_IPOL    0x01
-  #define ACE128_MCP23008_GPINTEN 0x02
-  #define ACE128_MCP23008_DEFVAL  0x03
-  #define ACE128_MCP23008_INTCON  0x04
-  #define ACE128_MCP23008_IOCON   0x05
-  #define ACE128_MCP23008_GPPU    0x06
-  #define ACE128_MCP23008_INTF    0x07
-  #define ACE128_MCP23008_INTCAP  0x08
-  #define ACE128_MCP23008_GPIO    0x09
-  #define ACE128_MCP23008_OLAT    0x0A
+
+#ifdef ACE128_EXPANDER16
+// 16 bit expanders
+  #define ACE128_CHIP_MCP23017    1
+  #define ACE128_CHIP_PCA9555     2
+  #define ACE128_CHIP_PCF8575     3
+  #define ACE128_MCP23017_IODIRA  0x00  // IOCON.BANK = 0 register numbers
+  #define ACE128_MCP23017_IOCON   0x0A
+  #define ACE128_MCP23017_GPIOA   0x12
+  #define ACE128_PCA9555_INPUT0   0x00
+  #define ACE128_PCA9555_POLARITY0 0x04
+  #define ACE128_PCA9555_CONFIG0  0x06
 #endif
 
 // PCF8574 family
 #define ACE128_PCF8574_ADDRESS  0x20
 #define ACE128_PCF8574A_ADDRESS 0x38
 
+#ifdef ACE128_FAST_PINS
+void ACE128ports::begin(const uint8_t *pins)
+{
+  port[0] = NULL;
+  port[1] = NULL;
+  onPort1 = 0;
+  for (uint8_t i = 0; i <= 7; i++) {
+    uint8_t p = digitalPinToPort(pins[i]);
+    volatile uint8_t *reg = (p == NOT_A_PIN) ? NULL : portInputRegister(p);
+    bit[i] = digitalPinToBitMask(pins[i]);
+    if (reg != NULL && (port[0] == NULL || port[0] == reg)) {
+      port[0] = reg;
+    } else if (reg != NULL && (port[1] == NULL || port[1] == reg)) {
+      port[1] = reg;
+      onPort1 |= 1 << i;
+    } else {
+      port[0] = NULL;   // too scattered - fall back to digitalRead()
+      break;
+    }
+  }
+}
+
+uint8_t ACE128ports::read()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t port0 = *port[0];
+  uint8_t port1 = (port[1] != NULL) ? *port[1] : 0;
+  SREG = oldSREG;
+  uint8_t pinbits = 0;
+  for (uint8_t pin = 0; pin <= 7; pin++) {
+    if (((onPort1 >> pin) & 1 ? port1 : port0) & bit[pin]) {
+      pinbits |= 1 << pin;
+    }
+  }
+  return(pinbits);
+}
+#endif
+
+#ifdef ACE128_COMPACT_MAP
+// Each ACE-128 pin reads the same track 16 positions behind the one before, so with the code bits in pin order
+// (pin 1 in bit 0) the code 16 positions on is the code rotated right one bit. That leaves 16 groups of 8.
+// These are the codes in each group that are their own smallest rotation, in order, each with its raw position.
+PROGMEM const uint8_t ACE128_compact[32] = {
+  0x01,  56, 0x03,  55, 0x07,  52, 0x09,  57, 0x0F,  13, 0x13,  54, 0x17,  53, 0x1D,  19,
+  0x1F,  18, 0x25, 106, 0x2F,  14, 0x35, 107, 0x3D, 108, 0x3F,   1, 0x5F, 127, 0x7F,   0
+};
+#endif
+
+#ifdef ACE128_TRACE
+// trace format, see ACE128trace.h
+#define ACE128_TRACE_VERSION 1
+#define ACE128_TRACE_REPEAT  0x80  // 10nnnnnn - n + 1 repeats of the last pins
+#define ACE128_TRACE_LONG    0xC0  // sample after a gap of 128ms or more
+#define ACE128_TRACE_STATE   0xC1  // zero, reverse, last position and turn count
+#define ACE128_TRACE_IDLE    0xC2  // long run of repeats
+#define ACE128_TRACE_NONE    0xFFFF  // _tRun before the first sample
+#endif
+
+#ifdef ACE128_ASYNC
+// startRead() states
+#define ACE128_ASYNC_DONE    0  // nothing in progress, _aPins is good
+#define ACE128_ASYNC_WAIT    1  // waiting for the bus to finish a STOP
+#define ACE128_ASYNC_W_START 2  // START sent to write the MCP23008 register pointer
+#define ACE128_ASYNC_W_SLA   3  // SLA+W sent
+#define ACE128_ASYNC_W_REG   4  // register number sent
+#define ACE128_ASYNC_R_START 5  // START sent to read the pins
+#define ACE128_ASYNC_R_SLA   6  // SLA+R sent
+#define ACE128_ASYNC_R_DATA  7  // waiting for the pin byte
+#endif
+
 
 // former cpp code starts here
 
@@ -179,6 +714,43 @@ ACE128::ACE128(uint8_t pin0, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t p
   _reverse = false;                        // clockwise
   _zero = 0;                               // set zero position
   _map = map;                              // mapping table in PROGMEM
+  #ifdef ACE128_RAM_MAP
+  _mapRam = false;
+  #endif
+  #ifdef ACE128_ASYNC
+  _aState = ACE128_ASYNC_DONE;
+  _aPins = 0;
+  _aMs = 0;
+  #endif
+  #ifdef ACE128_POLL
+  _pollms = 0;
+  _pollInterval = ACE128_POLL_MIN_MS;
+  _ambiguous = false;
+  #endif
+  #ifdef ACE128_VELOCITY
+  _vnext = 0;
+  _vcount = 0;
+  #endif
+  #ifdef ACE128_RECOVER
+  _lastraw = 0;
+  _decodeError = 0;
+  #endif
+  #ifdef ACE128_STATS
+  resetStats();
+  #endif
+  #ifdef ACE128_TRACE
+  _trace = NULL;
+  #endif
+  #ifdef ACE128_EVENTS
+  _evDetents = 128;
+  _evHysteresis = 0;
+  _evDetent = 0;
+  _evDir = 0;
+  _evSync = true;
+  _evHandler = NULL;
+  _evHead = 0;
+  _evTail = 0;
+  #endif
   #ifndef ACE128_EEPROM_NONE
   _eeAddr = eeAddr;                       // multiturn save location
   #endif
@@ -202,15 +774,89 @@ ACE128::ACE128(uint8_t i2caddr, uint8_t *map, int16_t eeAddr)
   {
     _i2caddr = (i2caddr & 0x7) | ACE128_MCP23008_ADDRESS;   // map lower bits to MCP23008
     _chip = ACE128_MCP23008_ADDRESS;                        // remember what chip
+    _parked = false;                                        // don't know where the register pointer is
   }
   #endif
   _reverse = false;                        // clockwise
   _zero = 0;                               // set zero position
   _map = map;                              // mapping table in PROGMEM
+  #ifdef ACE128_RAM_MAP
+  _mapRam = false;
+  #endif
+  #ifdef ACE128_ASYNC
+  _aState = ACE128_ASYNC_DONE;
+  _aPins = 0;
+  _aMs = 0;
+  #endif
+  #ifdef ACE128_POLL
+  _pollms = 0;
+  _pollInterval = ACE128_POLL_MIN_MS;
+  _ambiguous = false;
+  #endif
+  #ifdef ACE128_VELOCITY
+  _vnext = 0;
+  _vcount = 0;
+  #endif
+  #ifdef ACE128_RECOVER
+  _lastraw = 0;
+  _decodeError = 0;
+  #endif
+  #ifdef ACE128_STATS
+  resetStats();
+  #endif
+  #ifdef ACE128_TRACE
+  _trace = NULL;
+  #endif
+  #ifdef ACE128_EVENTS
+  _evDetents = 128;
+  _evHysteresis = 0;
+  _evDetent = 0;
+  _evDir = 0;
+  _evSync = true;
+  _evHandler = NULL;
+  _evHead = 0;
+  _evTail = 0;
+  #endif
   #ifndef ACE128_EEPROM_NONE
   _eeAddr = eeAddr;                       // multiturn save location
   #endif
+  #ifdef ACE128_INTERRUPT
+  _intPin = -1;                            // poll the bus until told otherwise
+  _intStale = true;
+  #endif
+  #ifdef ACE128_MUX
+  _mux = -1;                               // main bus until told otherwise
+  #endif
+  #ifdef ACE128_EXPANDER16
+  _x16 = NULL;
+  #endif
+}
+
+  #ifdef ACE128_EXPANDER16
+    #ifdef ACE128_EEPROM_NONE
+ACE128::ACE128(ACE128expander16 &chip, uint8_t port, uint8_t *map) : ACE128::ACE128(chip._i2caddr, map)
+    #else
+ACE128::ACE128(ACE128expander16 &chip, uint8_t port, uint8_t *map) : ACE128::ACE128(chip, port, map, -1) {}
+ACE128::ACE128(ACE128expander16 &chip, uint8_t port, uint8_t *map, int16_t eeAddr) : ACE128::ACE128(chip._i2caddr, map, eeAddr)
+    #endif
+{
+  _x16 = &chip;
+  _x16port = port & 1;
+}
+
+ACE128expander16::ACE128expander16(uint8_t i2caddr, uint8_t chip)
+{
+  _i2caddr = i2caddr;
+  _chip = chip;
+  _begun = false;
+  _parked = false;
+  _fresh = 0;
+  _readMs = 0;
+  #ifdef ACE128_STATS
+  _errors = 0;
+  #endif
 }
+  #endif
 #endif // ACE128_ARDUINO_PINS
 
 // Initializer /////////////////////////////////////////////////////////////////
@@ -221,41 +867,60 @@ void ACE128::begin()
 #ifdef ACE128_I2C    // if we are using I2C, initialize it
   Wire.begin();      // join i2c bus (address optional for master)
 #endif
+  _begin();
+}
 
+// everything begin() does apart from starting the bus - ACE128group starts it once for all its encoders
+void ACE128::_begin()
+{
 #ifdef ACE128_ARDUINO_PINS
   // initialize the pins
   for (uint8_t i = 0; i <= 7; i++) {
     pinMode(_pins[i], INPUT_PULLUP);
   }
+  #ifdef ACE128_FAST_PINS
+  _ports.begin(_pins);   // work out which port registers our pins live on so acePins() can read them all at once
+  #endif
 #else
-  Wire.beginTransmission(_i2caddr);
-  #ifdef ACE128_MCP23008
-  if (_chip == ACE128_MCP23008_ADDRESS)
+  #ifdef ACE128_MUX
+  _muxSelect();
+  #endif
+  #ifdef ACE128_EXPANDER16
+  if (_x16 != NULL)
   {
-    Wire.write((uint8_t)ACE128_MCP23008_IODIR); // MCP23008 lets us blast all registers
-    Wire.write((uint8_t)0xFF);  // IODIR all inputs
-    Wire.write((uint8_t)0x00);  // IPOL  do not invert
-    Wire.write((uint8_t)0x00);  // GPINTEN disable interrupt
-    Wire.write((uint8_t)0x00);  // DEFVAL disabled
-    Wire.write((uint8_t)0x00);  // INTCON disabled
-    Wire.write((uint8_t)0x00);  // IOCON no special config
-    Wire.write((uint8_t)0xFF);  // GPPU pullup all inputs
-    Wire.write((uint8_t)0x00);  // INTF disabled
-    Wire.write((uint8_t)0x00);  // INTCAP disabled
-    Wire.write((uint8_t)0x00);  // GPIO
-    Wire.write((uint8_t)0x00);  // OLAT
+    _x16->_begin();
+  }
+  else
+  #endif
+  {
+    #ifdef ACE128_MCP23008
+    if (_chip == ACE128_MCP23008_ADDRESS)
+    {
+      #ifdef ACE128_INTERRUPT
+      _parked = ACE128_mcp23008_begin(_i2caddr, _intPin >= 0);
+      #else
+      _parked = ACE128_mcp23008_begin(_i2caddr);
+      #endif
+    }
+    else if (_chip == ACE128_PCF8574A_ADDRESS)
+    #endif // ACE128_MCP23008
+    {
+      Wire.beginTransmission(_i2caddr);
+      Wire.write((uint8_t)0xFF);  // set all pins up. pulldown for input
+      Wire.endTransmission();
+    }
   }
-  else if (_chip == ACE128_PCF8574A_ADDRESS)
-  #endif // ACE128_MCP23008
+  #ifdef ACE128_INTERRUPT
+  if (_intPin >= 0)
   {
-    Wire.write((uint8_t)0xFF);  // set all pins up. pulldown for input
+    pinMode(_intPin, INPUT_PULLUP); // INT is open drain, active low
   }
-  Wire.endTransmission();
+  _intStale = true;                 // we can't trust anything read before this
+  #endif
 #endif
 #ifndef ACE128_EEPROM_NONE
-  if (_eeAddr >= 0)
+  if (_eeAddr >= 0 && _eeprom_read_settings())
   {
-    _eeprom_read_settings();
     _lastpos = pos();
   }
   else
@@ -265,6 +930,34 @@ void ACE128::begin()
     _zero = rawPos(); // set zero to where we happen to be
     _lastpos = 0;
   }
+#ifdef ACE128_QUEUE
+  _qoverflow = 0;
+  _qseen = 0;
+  _queue_sync();
+#endif
+#ifdef ACE128_EVENTS
+  _evSync = true;          // a new position, not a move
+#endif
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceState();
+#endif
+}
+
+// state saved by someone else - ACE128store - with the knob now at raw position rawpos
+void ACE128::_restore(uint8_t zero, int16_t mpos, uint8_t rawpos)
+{
+  _zero = zero;
+  _mpos = mpos;
+  _lastpos = _raw2pos(rawpos);
+#ifdef ACE128_QUEUE
+  _queue_sync();
+#endif
+#ifdef ACE128_EVENTS
+  _evSync = true;          // a new position, not a move
+#endif
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceState();
+#endif
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -275,32 +968,133 @@ void ACE128::begin()
 // If you ever get a 255 from a mapping table, something is wrong
 uint8_t ACE128::acePins(void)
 {
+#ifdef ACE128_STATS
+  unsigned long start = micros();
+  uint8_t pins = _readPins();
+  _statsRead(micros() - start);
+  return (pins);
+#else
+  return (_readPins());
+#endif
+}
+
+uint8_t ACE128::_readPins(void)
+{
 #ifdef ACE128_ARDUINO_PINS
+  #ifdef ACE128_FAST_PINS
+  if (_ports.port[0] != NULL) {
+    return(_ports.read());  // sample the port(s) in one go
+  }
+  #endif
   uint8_t pinbits = 0;
   for (uint8_t pin = 0; pin <= 7; pin++) {
     pinbits |= (uint8_t)digitalRead(_pins[pin]) << pin;
   }
   return(pinbits);
 #else
+  #ifdef ACE128_EXPANDER16
+  if (_x16 != NULL)
+  {
+    #ifdef ACE128_MUX
+    _muxSelect();
+    #endif
+    uint8_t pins = _x16->_read(_x16port); // a read of both ports clears INT for both, so no INT shortcut here
+    #ifdef ACE128_STATS
+    for (; _x16->_errors > 0; _x16->_errors--) ACE128_COUNT(busErrors);
+    #endif
+    return (pins);
+  }
+  #endif
+  #ifdef ACE128_INTERRUPT
+  if (!changed())
+  {
+    return (_intPins);  // INT not asserted - the pins are as we last read them
+  }
+  #endif
+  #ifdef ACE128_MUX
+  _muxSelect();
+  #endif
   // read one byte from the chip
   #if defined(ACE128_MCP23008)
-  if (_chip == ACE128_MCP23008_ADDRESS)
+  if (_chip == ACE128_MCP23008_ADDRESS && !_parked)
   {
     Wire.beginTransmission(_i2caddr);
     Wire.write((uint8_t)ACE128_MCP23008_GPIO);
-    Wire.endTransmission();
+    _parked = (Wire.endTransmission() == 0);  // SEQOP keeps it there, try again next time if that failed
+    if (!_parked) ACE128_COUNT(busErrors);
   }
   #endif
-  Wire.requestFrom(_i2caddr, 1);
+  if (Wire.requestFrom(_i2caddr, 1) != 1) ACE128_COUNT(busErrors);
+  #ifdef ACE128_INTERRUPT
+  _intPins = Wire.read();  // reading GPIO clears the interrupt on both chip families
+  _intStale = false;
+  return (_intPins);
+  #else
   return (Wire.read());
+  #endif
 #endif
 }
 
 // returns current raw position
 uint8_t ACE128::rawPos(void)
 {
-  // look up our raw position in the mapping table
-  return (pgm_read_byte(_map + acePins()));
+  return (_pins2raw(acePins()));
+}
+
+// look up our raw position in the mapping table
+uint8_t ACE128::_pins2raw(uint8_t pins)
+{
+  uint8_t raw = _lookup(pins);
+  if (raw == 0xFF) ACE128_COUNT(invalid);
+#ifdef ACE128_RECOVER
+  if (raw == 0xFF) {
+    return (_recover(pins));
+  }
+  _decodeError = 0;
+  _lastraw = raw;
+#endif
+  return (raw);
+}
+
+uint8_t ACE128::_lookup(uint8_t pins)
+{
+#ifdef ACE128_COMPACT_MAP
+  // move each bit to its ACE-128 pin number
+  uint8_t code = 0;
+  for (uint8_t i = 0; i <= 7; i++) {
+    if (pins & (1 << i)) code |= 1 << (_mapByte(i) - 1);
+  }
+  // find the smallest rotation, remembering how far we turned it
+  uint8_t least = code;
+  uint8_t turn = 0;
+  for (uint8_t k = 1; k <= 7; k++) {
+    code = (code << 1) | (code >> 7);
+    if (code < least) {
+      least = code;
+      turn = k;
+    }
+  }
+  // binary search the group list. A code that had to turn left k bits is 16 * k positions past its group entry
+  uint8_t lo = 0;
+  uint8_t hi = 16;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    uint8_t group = pgm_read_byte(ACE128_compact + mid * 2);
+    if (group == least) return ((pgm_read_byte(ACE128_compact + mid * 2 + 1) + turn * 16) & 0x7F);
+    if (group < least) lo = mid + 1; else hi = mid;
+  }
+  return (0xFF);                   // not an ACE-128 code
+#else
+  return (_mapByte(pins));
+#endif
+}
+
+uint8_t ACE128::_mapByte(uint8_t i)
+{
+#ifdef ACE128_RAM_MAP
+  if (_mapRam) return (_map[i]);
+#endif
+  return (pgm_read_byte(_map + i));
 }
 
 // returns unsigned position 0 - 127
@@ -321,28 +1115,52 @@ int8_t ACE128::pos(void)
 }
 
 int8_t ACE128::_raw2pos(int8_t pos) {
-  pos -= _zero;   // adjust for logical zero
-  if (_reverse) pos *= -1;    // reverse direction
-  // 7bit signed numbers need to copy their neg bit to the 8bit position
-  if ( pos & 0x40 ) { // check for 7bit neg bit
-    pos |= 0x80; // set 8bit neg bit
-  } else {
-    pos &= 0x7F; // clear 8bit neg bit
-  }
-  return (pos);
+  return (ACE128math::raw2pos(pos, _zero, _reverse));
 }
 
 int16_t ACE128::mpos(void)
 {
-  int16_t currentpos = pos();
-  if ((int16_t)_lastpos - currentpos > 0x40)    // more than half a turn smaller - we rolled up
-  {
-    _mpos += 0x80;
-  }
-  else if (currentpos - (int16_t)_lastpos > 0x40)   // more than half a turn bigger - we rolled down
-  {
-    _mpos -= 0x80;
-  }
+#ifdef ACE128_TRACE
+  if (_trace != NULL) return (sample().mpos);  // so it gets traced
+#endif
+  return (_mpos_update(pos(), millis()));
+}
+
+// reads the pins once and derives every position form from that single read
+// use this instead of calling upos(), pos() and mpos() in turn, which costs a bus read each
+// and can return values from different positions if the knob is moving
+ACE128sample ACE128::sample(void)
+{
+  uint8_t pins = acePins();
+  return (_sample(pins, millis()));
+}
+
+// decode pins that have already been read
+ACE128sample ACE128::_sample(uint8_t pins, unsigned long ms)
+{
+  ACE128sample s;
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceSample(pins, ms);
+#endif
+  s.pins = pins;
+  s.ms = ms;
+  s.raw = _pins2raw(s.pins);
+  s.pos = _raw2pos(s.raw);
+  s.upos = s.pos & 0x7F;          // same as upos() - drop the sign extension
+  s.mpos = _mpos_update(s.pos, ms);
+  return (s);
+}
+
+// multiturn bookkeeping shared by mpos() and sample()
+int16_t ACE128::_mpos_update(int8_t pos, unsigned long ms)
+{
+  int16_t currentpos = pos;
+#ifdef ACE128_POLL
+  _poll_update(currentpos - _lastpos);
+#endif
+  int16_t turn = ACE128math::rollover(_lastpos, currentpos);
+  if (turn != 0) ACE128_COUNT(rollovers);
+  _mpos += turn;
 #ifndef ACE128_EEPROM_NONE
   if (_eeAddr >= 0)
   {
@@ -350,6 +1168,14 @@ int16_t ACE128::mpos(void)
   }
 #endif
   _lastpos = currentpos;
+#ifdef ACE128_VELOCITY
+  _velocity_add(_mpos + currentpos, ms);
+#else
+  (void)ms;
+#endif
+#ifdef ACE128_EVENTS
+  _events_update(_mpos + currentpos);
+#endif
   return _mpos + currentpos;
 }
 
@@ -360,9 +1186,18 @@ void ACE128::setZero(uint8_t rawPos)
 #ifndef ACE128_EEPROM_NONE
   if (_eeAddr >= 0)
   {
-    _eeprom_write_zero();
+    _eeprom_write_zero();  // always immediate, even with the journal
   }
 #endif
+#ifdef ACE128_QUEUE
+  _queue_sync();
+#endif
+#ifdef ACE128_EVENTS
+  _evSync = true;          // a new position, not a move
+#endif
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceState();
+#endif
 }
 
 // set current position to zero
@@ -381,15 +1216,25 @@ uint8_t ACE128::getZero(void)
 void ACE128::setMpos(int16_t mPos)
 {
   uint8_t rawpos = rawPos();
-  setZero(rawpos - (uint8_t)(mPos & 0x7f));  // mask to 7bit
+  _zero = ACE128math::zeroFor(rawpos, mPos);
   _lastpos = _raw2pos(rawpos);
-  _mpos = (mPos - _lastpos) & 0xFF80;          // mask higher 9 bits
+  _mpos = ACE128math::turnsFor(mPos, _lastpos);
 #ifndef ACE128_EEPROM_NONE
   if (_eeAddr >= 0)
   {
+    _eeprom_write_zero();  // with the journal this saves _mpos too
     _eeprom_write_mpos();
   }
 #endif
+#ifdef ACE128_QUEUE
+  _queue_sync();
+#endif
+#ifdef ACE128_EVENTS
+  _evSync = true;          // a new position, not a move
+#endif
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceState();
+#endif
 }
 
 
@@ -397,15 +1242,957 @@ void ACE128::setMpos(int16_t mPos)
 void ACE128::reverse(boolean reverse)
 {
   _reverse = reverse;
+#ifdef ACE128_EVENTS
+  _evSync = true;          // a new position, not a move
+#endif
+#ifdef ACE128_TRACE
+  if (_trace != NULL) _traceState();
+#endif
 }
 
-// Private Methods /////////////////////////////////////////////////////////////
-// Functions only available to other functions in this library
-#ifndef ACE128_EEPROM_NONE
-// read _mpos and _zero from
-void ACE128::_eeprom_read_settings()
+// change the map table, e.g. to one ACE128calibrate built. Raw positions change with it, so setMpos() or
+// setZero() afterwards if the knob was already counting
+#ifdef ACE128_RAM_MAP
+void ACE128::setMap(uint8_t *map, boolean ram)
+#else
+void ACE128::setMap(uint8_t *map)
+#endif
 {
-  #if defined(ACE128_EEPROM_I2C)
+  _map = map;
+#ifdef ACE128_RAM_MAP
+  _mapRam = ram;
+#endif
+}
+
+#ifdef ACE128_VELOCITY
+// Velocity is the least squares slope of mpos against time over the ring:
+//   (n * sum(t * x) - sum(t) * sum(x)) / (n * sum(t * t) - sum(t) * sum(t))
+// with t and x taken relative to the newest sample to keep the sums small.
+// Samples more than ACE128_VELOCITY_AGE ms older than the newest are left out, which also
+// keeps every sum inside 32 bits for any knob a human can turn.
+#define ACE128_VELOCITY_AGE 1024
+
+// keep a sample if enough time has passed since the last one
+// now is when the pins were read, which for readQueue() and ACE128replay can be well before millis()
+void ACE128::_velocity_add(int16_t mpos, uint16_t now)
+{
+  uint8_t last = (_vnext == 0 ? ACE128_VELOCITY : _vnext) - 1;
+  if (_vcount > 0 && (uint16_t)(now - _vms[last]) < ACE128_VELOCITY_MS) return;
+  _vms[_vnext] = now;
+  _vpos[_vnext] = mpos;
+  _vnext = (_vnext + 1 >= ACE128_VELOCITY) ? 0 : _vnext + 1;
+  if (_vcount < ACE128_VELOCITY) _vcount++;
+}
+
+// slope of n samples in steps per second, after skipping the newest skip samples
+// age gets the mean age of the samples used, relative to the newest sample in the ring
+int32_t ACE128::_velocity_fit(uint8_t skip, uint8_t n, int16_t *age)
+{
+  uint8_t newest = (_vnext == 0 ? ACE128_VELOCITY : _vnext) - 1;
+  int32_t st = 0, sx = 0, stt = 0, stx = 0;
+  uint8_t used = 0;
+  *age = 0;
+  for (uint8_t i = skip; i < skip + n && i < _vcount; i++) {
+    uint8_t slot = (newest >= i) ? newest - i : newest + ACE128_VELOCITY - i;
+    int32_t t = -(int32_t)(uint16_t)(_vms[newest] - _vms[slot]);
+    int32_t x = (int16_t)(_vpos[slot] - _vpos[newest]);
+    if (t < -ACE128_VELOCITY_AGE) break;
+    st += t;
+    sx += x;
+    stt += t * t;
+    stx += t * x;
+    used++;
+  }
+  if (used < 2) return (0);
+  *age = -st / used;
+  int32_t num = used * stx - st * sx;
+  int32_t den = used * stt - st * st;
+  if (den == 0) return (0);
+  while (num > 2000000L || num < -2000000L) {  // make room to scale ms to s
+    num /= 2;
+    den /= 2;
+  }
+  return (num * 1000 / den);
+}
+
+// the fit is the speed at the mean age of the samples, so move it on to the newest sample with the acceleration -
+// otherwise a knob speeding up reads a few tens of ms slow. The newest sample is up to ACE128_VELOCITY_MS old.
+int16_t ACE128::velocity()
+{
+  int16_t age;
+  int32_t v = _velocity_fit(0, _vcount, &age);
+  v += (int32_t)acceleration() * age / 1000;
+  return (v > 32767 ? 32767 : v < -32767 ? -32767 : v);
+}
+
+// change in velocity between the older and newer halves of the ring
+// Positions are whole steps, so even a steady spin gives the two halves slightly different slopes - typically
+// 2 / T^2 steps/s^2 for a ring spanning T seconds, about 100 at the defaults, and now and then twice that.
+// Less than 8 / T^2, a bend of 2/3 of a step off a straight line over the ring, reads as 0.
+int16_t ACE128::acceleration()
+{
+  int16_t ageNew, ageOld;
+  uint8_t half = _vcount / 2;
+  if (half < 2) return (0);
+  int32_t vNew = _velocity_fit(0, half, &ageNew);
+  int32_t vOld = _velocity_fit(half, half, &ageOld);
+  if (ageOld <= ageNew) return (0);
+  int32_t a = (vNew - vOld) * 1000 / (ageOld - ageNew);
+  uint8_t newest = (_vnext == 0 ? ACE128_VELOCITY : _vnext) - 1;
+  uint8_t oldest = (newest >= 2 * half - 1) ? newest - (2 * half - 1) : newest + ACE128_VELOCITY - (2 * half - 1);
+  int32_t span = (uint16_t)(_vms[newest] - _vms[oldest]);
+  if (span > ACE128_VELOCITY_AGE) span = ACE128_VELOCITY_AGE;
+  int32_t least = (span > 0) ? 8000000L / (span * span) : 0;
+  if (a < least && a > -least) return (0);
+  return (a > 32767 ? 32767 : a < -32767 ? -32767 : a);
+}
+
+// where the knob will be ms milliseconds from now if it keeps accelerating as it is
+// average of the velocity now and then, times the time
+int16_t ACE128::predict(uint16_t ms)
+{
+  if (_vcount == 0) return (_mpos + _lastpos);
+  uint8_t newest = (_vnext == 0 ? ACE128_VELOCITY : _vnext) - 1;
+  uint16_t ahead = (uint16_t)millis() - _vms[newest] + ms;
+  int32_t v = velocity();
+  v += (int32_t)acceleration() * ahead / 2000;
+  if (v > 32767) v = 32767;
+  if (v < -32767) v = -32767;
+  return (_vpos[newest] + (int16_t)(v * ahead / 1000));
+}
+#endif
+
+#ifdef ACE128_EXPANDER16
+// set up the chip once, whichever of its encoders gets to begin() first
+void ACE128expander16::_begin()
+{
+  if (_begun) return;
+  _begun = true;
+  _fresh = 0;
+  _readMs = 0;
+  _parked = false;
+  Wire.beginTransmission(_i2caddr);
+  if (_chip == ACE128_CHIP_MCP23017)
+  {
+    // a reset that left the chip powered leaves SEQOP set, which would keep the blast below on IODIRA and IODIRB
+    Wire.write((uint8_t)ACE128_MCP23017_IOCON);
+    Wire.write((uint8_t)0x00);  // IOCON no special config
+    Wire.endTransmission();
+    Wire.beginTransmission(_i2caddr);
+    Wire.write((uint8_t)ACE128_MCP23017_IODIRA); // blast IODIRA to GPPUB, the A and B registers alternate
+    Wire.write((uint8_t)0xFF);  // IODIRA all inputs
+    Wire.write((uint8_t)0xFF);  // IODIRB
+    Wire.write((uint8_t)0x00);  // IPOLA do not invert
+    Wire.write((uint8_t)0x00);  // IPOLB
+    Wire.write((uint8_t)0x00);  // GPINTENA disable interrupt
+    Wire.write((uint8_t)0x00);  // GPINTENB
+    Wire.write((uint8_t)0x00);  // DEFVALA disabled
+    Wire.write((uint8_t)0x00);  // DEFVALB
+    Wire.write((uint8_t)0x00);  // INTCONA disabled
+    Wire.write((uint8_t)0x00);  // INTCONB
+    Wire.write((uint8_t)0x00);  // IOCON no special config, BANK = 0
+    Wire.write((uint8_t)0x00);  // IOCON again - it is mapped at both addresses
+    Wire.write((uint8_t)0xFF);  // GPPUA pullup all inputs
+    Wire.write((uint8_t)0xFF);  // GPPUB
+    Wire.endTransmission();
+    // with BANK = 0 and SEQOP set the pointer toggles between GPIOA and GPIOB, so once it is parked on GPIOA
+    // every 2 byte read gets A then B and leaves it back on GPIOA
+    Wire.beginTransmission(_i2caddr);
+    Wire.write((uint8_t)ACE128_MCP23017_IOCON);
+    Wire.write((uint8_t)0x20);  // IOCON SEQOP
+  }
+  else if (_chip == ACE128_CHIP_PCA9555)
+  {
+    // writes toggle within a register pair, so each pair gets its own transaction
+    Wire.write((uint8_t)ACE128_PCA9555_CONFIG0);
+    Wire.write((uint8_t)0xFF);  // CONFIG0 all inputs, the power on default
+    Wire.write((uint8_t)0xFF);  // CONFIG1
+    Wire.endTransmission();
+    Wire.beginTransmission(_i2caddr);
+    Wire.write((uint8_t)ACE128_PCA9555_POLARITY0);
+    Wire.write((uint8_t)0x00);  // POLARITY0 do not invert
+    Wire.write((uint8_t)0x00);  // POLARITY1
+  }
+  else
+  {
+    Wire.write((uint8_t)0xFF);  // PCF8575 set all pins up. pulldown for input
+    Wire.write((uint8_t)0xFF);
+    _parked = true;             // no registers
+  }
+  Wire.endTransmission();
+}
+
+// hand out a port, going to the bus only if this port has already had the last read, or it is too old to trust
+uint8_t ACE128expander16::_read(uint8_t port)
+{
+  if (!(_fresh & (1 << port)) || (uint16_t)((uint16_t)millis() - _readMs) > ACE128_EXPANDER16_MS)
+  {
+    if (!_parked)
+    {
+      Wire.beginTransmission(_i2caddr);
+      // the PCA9555 keeps reading the pair its command byte points at until it gets another one
+      Wire.write((uint8_t)(_chip == ACE128_CHIP_MCP23017 ? ACE128_MCP23017_GPIOA : ACE128_PCA9555_INPUT0));
+      _parked = (Wire.endTransmission() == 0);  // try again next time if that failed
+    #ifdef ACE128_STATS
+      if (!_parked) _errors++;
+    #endif
+    }
+    #ifdef ACE128_STATS
+    if (Wire.requestFrom(_i2caddr, 2) != 2) _errors++;
+    #else
+    Wire.requestFrom(_i2caddr, 2);
+    #endif
+    _pins[0] = Wire.read();
+    _pins[1] = Wire.read();
+    _fresh = 0x03;
+    _readMs = millis();
+  }
+  _fresh &= ~(1 << port);
+  return (_pins[port]);
+}
+#endif
+
+#ifdef ACE128_WIRE_BATCH
+// Wire transports that can send many transfers at once (see extras/linux/Wire.h) let ACE128group read a whole
+// panel in one go. Register pointers are written every time as part of the batch, so it doesn't matter where
+// they were left. Reads land in pins, or for a 16 bit expander in the chip's own buffer
+boolean ACE128::_batchQueue(uint8_t *pins)
+{
+  #ifdef ACE128_EXPANDER16
+  if (_x16 != NULL)
+  {
+    if (_x16->_fresh & 0x80) return (true);  // the other port has already queued the chip
+    if (Wire.batchRoom() < 2) return (false);
+    if (_x16->_chip != ACE128_CHIP_PCF8575)
+    {
+      uint8_t reg = (_x16->_chip == ACE128_CHIP_MCP23017) ? ACE128_MCP23017_GPIOA : ACE128_PCA9555_INPUT0;
+      Wire.batchWrite(_x16->_i2caddr, &reg, 1);
+    }
+    Wire.batchRead(_x16->_i2caddr, _x16->_pins, 2);
+    _x16->_fresh = 0x80;           // queued, nothing to hand out until the batch has gone
+    return (true);
+  }
+  #endif
+  if (Wire.batchRoom() < 2) return (false);
+  #ifdef ACE128_MCP23008
+  if (_chip == ACE128_MCP23008_ADDRESS)
+  {
+    uint8_t reg = ACE128_MCP23008_GPIO;
+    Wire.batchWrite(_i2caddr, &reg, 1);
+  }
+  #endif
+  Wire.batchRead(_i2caddr, pins, 1);
+  return (true);
+}
+
+uint8_t ACE128::_batchPins(uint8_t pins)
+{
+  #ifdef ACE128_EXPANDER16
+  if (_x16 != NULL)
+  {
+    _x16->_fresh = 0;
+    _x16->_parked = true;
+    return (_x16->_pins[_x16port]);
+  }
+  #endif
+  #ifdef ACE128_MCP23008
+  _parked = true;                  // the batch left the pointer on GPIO
+  #endif
+  #ifdef ACE128_INTERRUPT
+  _intPins = pins;                 // the batch read cleared INT, as any other read does
+  _intStale = false;
+  #endif
+  return (pins);
+}
+#endif
+
+#ifdef ACE128_MUX
+// the TCA9548A takes one control byte with a bit per channel. We only ever open one channel, and only write it when
+// the encoder we are about to talk to is on a different channel to the one that is open
+void ACE128::setMux(int8_t channel)
+{
+  _mux = channel;
+}
+
+int8_t ACE128::mux()
+{
+  return (_mux);
+}
+
+unsigned long ACE128::muxSwitches()
+{
+  return (_muxSwitches);
+}
+
+void ACE128::_muxSelect()
+{
+  if (_mux < 0 || _muxOpen == (uint8_t)(1 << _mux)) return;
+  Wire.beginTransmission(ACE128_MUX_ADDR);
+  Wire.write((uint8_t)(1 << _mux));
+  _muxOpen = (Wire.endTransmission() == 0) ? (1 << _mux) : 0xFF;  // try again next time if that failed
+  if (_muxOpen == 0xFF) ACE128_COUNT(busErrors);
+  _muxSwitches++;
+}
+#endif
+
+#ifdef ACE128_STATS
+ACE128stats ACE128::stats()
+{
+  noInterrupts();                // isrSample() may be counting
+  ACE128stats s = _stats;
+  interrupts();
+  return (s);
+}
+
+void ACE128::resetStats()
+{
+  noInterrupts();
+  _stats = ACE128stats();
+  interrupts();
+}
+
+// the bucket is the bit length of us
+void ACE128::_statsRead(unsigned long us)
+{
+  uint8_t bucket = 0;
+  for (; us > 0 && bucket < ACE128_STATS_BUCKETS - 1; us >>= 1) bucket++;
+  ACE128_COUNT(reads);
+  ACE128_COUNT(latency[bucket]);
+}
+#endif
+
+#ifdef ACE128_EVENTS
+void ACE128::setDetents(uint8_t detents, uint8_t hysteresis)
+{
+  _evDetents = (detents >= 1 && detents <= 128) ? detents : 128;
+  _evHysteresis = hysteresis;
+  _evSync = true;
+}
+
+void ACE128::onEvent(void (*handler)(ACE128 &encoder, uint8_t event, int16_t value))
+{
+  _evHandler = handler;
+}
+
+boolean ACE128::readEvent(ACE128event &e)
+{
+  if (_evTail == _evHead) return (false);
+  e = _evQueue[_evTail & (ACE128_EVENTS_QUEUE - 1)];
+  _evTail++;
+  return (true);
+}
+
+int16_t ACE128::detent()
+{
+  return (_evDetent);
+}
+
+int16_t ACE128::_floorDiv(int32_t a, int16_t b)
+{
+  return ((a >= 0) ? a / b : -((-a + b - 1) / b));
+}
+
+// In units of 1/128 detent, u = mpos * detents, and detent d runs from d * 128 - 64 up to d * 128 + 63.
+// Moving up, u has to be past the boundary by the hysteresis, so we look at u less the hysteresis, and moving
+// down at u plus the hysteresis. A jump of several detents gives one move event with the new detent.
+void ACE128::_events_update(int16_t mpos)
+{
+  int32_t u = (int32_t)mpos * _evDetents;
+  int32_t h = (int32_t)_evHysteresis * _evDetents;
+  if (_evSync)
+  {
+    _evDetent = _floorDiv(u + 64, 128);
+    _evSync = false;
+    return;
+  }
+  int16_t d = _floorDiv(u - h + 64, 128);
+  if (d <= _evDetent)
+  {
+    d = _floorDiv(u + h + 64, 128);
+    if (d >= _evDetent) return;    // within the hysteresis of our detent
+  }
+  int8_t dir = (d > _evDetent) ? 1 : -1;
+  int16_t turn = _floorDiv(_evDetent, _evDetents);
+  _evDetent = d;
+  if (dir != _evDir)
+  {
+    _evDir = dir;
+    _event(ACE128_EVENT_DIRECTION, dir);
+  }
+  _event(ACE128_EVENT_MOVE, d);
+  if (_floorDiv(d, _evDetents) != turn)
+  {
+    _event(ACE128_EVENT_TURN, _floorDiv(d, _evDetents));
+  }
+}
+
+// events that don't fit the queue are dropped - MOVE and TURN carry positions, so the next one catches up
+void ACE128::_event(uint8_t event, int16_t value)
+{
+  if (_evHandler != NULL)
+  {
+    _evHandler(*this, event, value);
+    return;
+  }
+  if ((uint8_t)(_evHead - _evTail) >= ACE128_EVENTS_QUEUE) return;
+  ACE128event &e = _evQueue[_evHead & (ACE128_EVENTS_QUEUE - 1)];
+  e.event = event;
+  e.value = value;
+  _evHead++;
+}
+#endif
+
+#ifdef ACE128_TRACE
+// the header is the magic bytes, the version and a state record, so a trace can start at any time
+void ACE128::setTrace(Print *out)
+{
+  if (_trace != NULL) _traceRun();  // finish off the trace we had
+  _trace = out;
+  if (_trace == NULL) return;
+  _trace->write((const uint8_t *)"ACET", 4);
+  _trace->write((uint8_t)ACE128_TRACE_VERSION);
+  _tMs = millis();
+  _tRun = ACE128_TRACE_NONE;
+  _traceState();
+}
+
+// a sample with the same pins as the last is only counted, and written as part of a run when the pins change
+void ACE128::_traceSample(uint8_t pins, unsigned long ms)
+{
+  if (_tRun != ACE128_TRACE_NONE && pins == _tPins)
+  {
+    _tRunMs = ms;
+    if (++_tRun == ACE128_TRACE_NONE - 1) _traceRun();  // as long a run as the counter holds
+    return;
+  }
+  _traceRun();
+  unsigned long dt = ms - _tMs;
+  if (dt < 0x80)
+  {
+    _trace->write((uint8_t)dt);
+  }
+  else
+  {
+    _trace->write((uint8_t)ACE128_TRACE_LONG);
+    _traceVarint(dt);
+  }
+  _trace->write(pins);
+  _tPins = pins;
+  _tMs = ms;
+  _tRun = 0;
+}
+
+void ACE128::_traceRun()
+{
+  if (_tRun == ACE128_TRACE_NONE || _tRun == 0) return;
+  if (_tRun <= 64)
+  {
+    _trace->write((uint8_t)(ACE128_TRACE_REPEAT | (_tRun - 1)));
+  }
+  else
+  {
+    _trace->write((uint8_t)ACE128_TRACE_IDLE);
+    _traceVarint(_tRun);
+  }
+  _traceVarint(_tRunMs - _tMs);
+  _tMs = _tRunMs;
+  _tRun = 0;
+}
+
+void ACE128::_traceState()
+{
+  _traceRun();
+  _trace->write((uint8_t)ACE128_TRACE_STATE);
+  _trace->write((uint8_t)(_zero | (_reverse ? 0x80 : 0)));
+  _trace->write((uint8_t)_lastpos);
+  _trace->write((uint8_t)_mpos);
+  _trace->write((uint8_t)(_mpos >> 8));
+}
+
+// 7 bits at a time, low first, top bit set on all but the last
+void ACE128::_traceVarint(unsigned long v)
+{
+  while (v >= 0x80)
+  {
+    _trace->write((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  _trace->write((uint8_t)v);
+}
+#endif
+
+#ifdef ACE128_ASYNC
+void ACE128::startRead()
+{
+#ifdef ACE128_ASYNC_TWI
+  #ifdef ACE128_INTERRUPT
+  if (!changed()) {
+    _aPins = acePins();  // INT says nothing moved - no bus traffic
+    _aMs = millis();
+    _aState = ACE128_ASYNC_DONE;
+    return;
+  }
+  #endif
+  _aMs = millis();       // start of the read, for the timeout
+  #ifdef ACE128_STATS
+  _aUs = micros();
+  #endif
+  _aState = ACE128_ASYNC_WAIT;
+  poll();
+#else
+  _aPins = acePins();    // no non-blocking bus here, do it now
+  _aMs = millis();
+  _aState = ACE128_ASYNC_DONE;
+#endif
+}
+
+// On AVR this drives the TWI hardware by hand, one bus step per call, with the TWI interrupt off so the Wire
+// library's interrupt handler stays out of it. Each step only starts when TWINT says the last one is done.
+// Status codes are from the ATmega328P datasheet TWI master tables. The STOP leaves TWCR as Wire leaves it.
+// One read has the hardware at a time - _aOwner - and the others wait in ACE128_ASYNC_WAIT until it is released
+// on success, error or timeout. Blocking reads mustn't be mixed in while a split read is in progress.
+boolean ACE128::poll()
+{
+#ifdef ACE128_ASYNC_TWI
+  if (_aState == ACE128_ASYNC_DONE) return (true);
+  if (_aOwner != NULL && _aOwner != this) {
+    _aMs = millis();     // another encoder's read has the bus - the timeout starts once we get it
+    return (false);
+  }
+  if (millis() - _aMs > ACE128_ASYNC_TIMEOUT_MS) {
+    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO);
+    ACE128_COUNT(busErrors);
+    _aOwner = NULL;
+    _aPins = acePins();  // bus stuck - let Wire sort it out
+    _aState = ACE128_ASYNC_DONE;
+    return (true);
+  }
+  if (_aState == ACE128_ASYNC_WAIT) {
+    if (TWCR & _BV(TWSTO)) return (false);
+    _aOwner = this;
+    #ifdef ACE128_EXPANDER16
+    if (_x16 != NULL) {
+      _aPins = acePins();  // often no bus traffic at all - the other port's read fetched ours
+      _aMs = millis();
+      _aOwner = NULL;
+      _aState = ACE128_ASYNC_DONE;
+      return (true);
+    }
+    #endif
+    #ifdef ACE128_MUX
+    _muxSelect();        // a short blocking Wire write, and only when the channel changes
+    #endif
+    #ifdef ACE128_MCP23008
+    _aState = (_chip == ACE128_MCP23008_ADDRESS && !_parked) ? ACE128_ASYNC_W_START : ACE128_ASYNC_R_START;
+    #else
+    _aState = ACE128_ASYNC_R_START;
+    #endif
+    TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN);
+    return (false);
+  }
+  if (!(TWCR & _BV(TWINT))) return (false);
+  uint8_t status = TWSR & 0xF8;
+  switch (_aState) {
+    case ACE128_ASYNC_W_START:
+    case ACE128_ASYNC_R_START:
+      if (status != 0x08 && status != 0x10) break;   // START or repeated START sent
+      TWDR = _twiAddr() | (_aState == ACE128_ASYNC_R_START ? 1 : 0);
+      TWCR = _BV(TWINT) | _BV(TWEN);
+      _aState++;
+      return (false);
+    #ifdef ACE128_MCP23008
+    case ACE128_ASYNC_W_SLA:
+      if (status != 0x18) break;                     // SLA+W acknowledged
+      TWDR = ACE128_MCP23008_GPIO;
+      TWCR = _BV(TWINT) | _BV(TWEN);
+      _aState = ACE128_ASYNC_W_REG;
+      return (false);
+    case ACE128_ASYNC_W_REG:
+      if (status != 0x28) break;                     // register number acknowledged
+      _parked = true;                                // SEQOP keeps it there
+      TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN);    // repeated START
+      _aState = ACE128_ASYNC_R_START;
+      return (false);
+    #endif
+    case ACE128_ASYNC_R_SLA:
+      if (status != 0x40) break;                     // SLA+R acknowledged
+      TWCR = _BV(TWINT) | _BV(TWEN);                 // take one byte, answer NACK
+      _aState = ACE128_ASYNC_R_DATA;
+      return (false);
+    case ACE128_ASYNC_R_DATA:
+      if (status != 0x58) break;                     // byte in, NACK sent
+      _aPins = TWDR;
+      #ifdef ACE128_INTERRUPT
+      _intPins = _aPins;
+      _intStale = false;
+      #endif
+      TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO);
+      _aMs = millis();
+      #ifdef ACE128_STATS
+      _statsRead(micros() - _aUs);
+      #endif
+      _aOwner = NULL;
+      _aState = ACE128_ASYNC_DONE;
+      return (true);
+  }
+  // anything unexpected - NACK, lost arbitration, bus error. Release the bus and go again
+  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO);
+  ACE128_COUNT(busErrors);
+  _aOwner = NULL;
+  #ifdef ACE128_MCP23008
+  _parked = false;
+  #endif
+  _aState = ACE128_ASYNC_WAIT;
+  return (false);
+#else
+  return (true);
+#endif
+}
+
+boolean ACE128::ready()
+{
+  return (_aState == ACE128_ASYNC_DONE);
+}
+
+ACE128sample ACE128::result()
+{
+  return (_sample(_aPins, _aMs));
+}
+#endif
+
+#ifdef ACE128_QUEUE
+// Single producer, single consumer ring. isrSample() only writes _qhead, readQueue() only writes _qtail, and both
+// are single bytes so each side sees the other's updates whole. Entries are filled before _qhead moves on, and read
+// before _qtail does. The entries aren't volatile, so a compiler barrier keeps their accesses on the right side of
+// the index updates.
+#define ACE128_QUEUE_BARRIER() asm volatile("" ::: "memory")
+// isrSample() keeps its own turn count in _qmpos and _qlastpos, so the count stays right even when samples are
+// dropped, and readQueue() brings the loop() side state (_mpos, _lastpos, EEPROM, velocity) up to each sample.
+void ACE128::isrSample()
+{
+  uint8_t pins = acePins();
+  #ifdef ACE128_RECOVER
+  uint8_t lastraw = _lastraw;      // loop()'s, which we may have interrupted mid decode
+  _lastraw = _qlastraw;
+  #endif
+  int8_t pos = _raw2pos(_pins2raw(pins));
+  #ifdef ACE128_RECOVER
+  _qlastraw = _lastraw;
+  _lastraw = lastraw;
+  #endif
+  _qmpos += ACE128math::rollover(_qlastpos, pos);
+  _qlastpos = pos;
+  if ((uint8_t)(_qhead - _qtail) >= ACE128_QUEUE) {
+    _qoverflow++;
+    return;
+  }
+  _queued &q = _queue[_qhead & (ACE128_QUEUE - 1)];
+  q.ms = millis();
+  q.mpos = _qmpos + pos;
+  q.pins = pins;
+  ACE128_QUEUE_BARRIER();          // entry written before it is published
+  _qhead++;
+}
+
+boolean ACE128::readQueue(ACE128sample &s)
+{
+  if (_qtail == _qhead) {
+    _queue_catchup();
+    return (false);
+  }
+  ACE128_QUEUE_BARRIER();          // entry read after _qhead says it is there
+  _queued &q = _queue[_qtail & (ACE128_QUEUE - 1)];
+  unsigned long now = millis();
+  s.ms = now - (uint16_t)((uint16_t)now - q.ms);
+  s.pins = q.pins;
+  s.mpos = q.mpos;
+  s.upos = q.mpos & 0x7F;
+  s.pos = (s.upos & 0x40) ? s.upos | 0x80 : s.upos;   // 7bit signed to 8bit
+  s.raw = ((_reverse ? -s.pos : s.pos) + _zero) & 0x7F;
+  ACE128_QUEUE_BARRIER();          // entry read before the slot is handed back
+  _qtail++;
+  // preset _mpos so that _mpos_update() lands on the producer's count whatever rollover it sees
+  _mpos = s.mpos - s.pos - ACE128math::rollover(_lastpos, s.pos);
+  _mpos_update(s.pos, s.ms);
+  #ifdef ACE128_TRACE
+  if (_trace != NULL) _traceSample(s.pins, s.ms);
+  #endif
+  return (true);
+}
+
+uint16_t ACE128::queueOverflows()
+{
+  noInterrupts();
+  uint16_t overflows = _qoverflow;
+  interrupts();
+  return (overflows);
+}
+
+// after begin(), setZero() or setMpos() - throw away samples taken with the old settings
+void ACE128::_queue_sync()
+{
+  noInterrupts();
+  _qmpos = _mpos;
+  _qlastpos = _lastpos;
+  #ifdef ACE128_RECOVER
+  _qlastraw = _lastraw;
+  #endif
+  _qtail = _qhead;
+  interrupts();
+}
+
+// The samples left in the queue after an overflow were taken before the ones dropped, so draining it leaves the
+// loop() side behind isrSample()'s count - by any number of turns. Once it is empty, start again from that count.
+void ACE128::_queue_catchup()
+{
+  noInterrupts();
+  uint16_t overflows = _qoverflow;
+  int16_t qmpos = _qmpos;
+  int8_t qlastpos = _qlastpos;
+  interrupts();
+  if (overflows == _qseen) return;
+  _qseen = overflows;
+  // preset _mpos as readQueue() does, so _mpos_update() lands on qmpos
+  _mpos = qmpos - ACE128math::rollover(_lastpos, qlastpos);
+  _mpos_update(qlastpos, millis());
+}
+#endif
+
+#ifdef ACE128_POLL
+// The knob must move less than half a turn (64 steps) between multiturn updates or we can't tell a rollover from
+// a turn the other way. We aim for no more than a quarter turn per update, and call anything over 3/8 of a turn ambiguous.
+#define ACE128_POLL_SAFE 32
+#define ACE128_POLL_AMBIGUOUS 48
+
+// step is the change in pos() since the last update, before rollover correction
+void ACE128::_poll_update(int8_t step)
+{
+  uint16_t now = millis();
+  uint16_t dt = now - _pollms;
+  _pollms = now;
+  step = (int8_t)(step << 1) >> 1;   // shortest way round, -64 to +63
+  if (step < 0) step = -step;
+  _ambiguous = (step >= ACE128_POLL_AMBIGUOUS);
+  if (step == 0) {
+    // idle - back off gently
+    _pollInterval = (_pollInterval >= ACE128_POLL_MAX_MS / 2) ? ACE128_POLL_MAX_MS : _pollInterval * 2;
+  } else {
+    // moving - time to cover a quarter turn at the speed we just saw
+    uint32_t interval = (uint32_t)dt * ACE128_POLL_SAFE / step;
+    _pollInterval = interval < ACE128_POLL_MIN_MS ? ACE128_POLL_MIN_MS :
+                    interval > ACE128_POLL_MAX_MS ? ACE128_POLL_MAX_MS : interval;
+  }
+}
+
+boolean ACE128::ambiguous()
+{
+  return (_ambiguous);
+}
+
+uint16_t ACE128::pollInterval()
+{
+  return (_pollInterval);
+}
+
+boolean ACE128::due()
+{
+  return ((uint16_t)((uint16_t)millis() - _pollms) >= _pollInterval);
+}
+#endif
+
+#ifdef ACE128_RECOVER
+// the map doubles as our table of valid codes - anything not 0xFF is one
+// adjacent positions differ by one bit, so a read torn between them is one of the two, and
+// a single misread contact is one bit from the truth. Try all 8 codes one bit away, then all 28 two bits away,
+// and take the valid one closest to where we last were. Good reads never come here.
+uint8_t ACE128::_recover(uint8_t pins)
+{
+  uint8_t best = 0xFF;
+  uint8_t bestGap = 0xFF;
+  for (uint8_t dist = 1; dist <= 2 && best == 0xFF; dist++) {
+    for (uint8_t i = 0; i <= 7; i++) {
+      for (uint8_t j = (dist == 1) ? i : i + 1; j <= 7; j++) {
+        uint8_t raw = _lookup(pins ^ (1 << i) ^ ((dist == 1) ? 0 : 1 << j));
+        if (raw != 0xFF) {
+          uint8_t gap = (raw - _lastraw) & 0x7F;  // circular distance from last good position
+          if (gap > 0x40) gap = 0x80 - gap;
+          if (gap < bestGap) {
+            bestGap = gap;
+            best = raw;
+          }
+        }
+        if (dist == 1) break;  // j only matters for two bit flips
+      }
+    }
+    _decodeError = dist;
+  }
+  if (best == 0xFF) {
+    _decodeError = 0xFF;
+    return (_lastraw);       // hopeless - stay put rather than jump
+  }
+  _lastraw = best;
+  return (best);
+}
+
+// how the last read went - see _recover()
+uint8_t ACE128::decodeError()
+{
+  return (_decodeError);
+}
+#endif
+
+#ifdef ACE128_INTERRUPT
+// use the expander INT output to skip bus reads when nothing moved
+// the PCF8574 asserts INT on any input change, the MCP23008 is set up to do the same in begin()
+// both release it when we read the pins, so we only need to read when it is low
+void ACE128::setIntPin(int8_t pin)
+{
+  _intPin = pin;
+}
+
+// true if acePins() will have to go to the bus
+// with a shared INT pin this is true until every chip on that pin has been read
+boolean ACE128::changed()
+{
+  return (_intStale || _intPin < 0 || digitalRead(_intPin) == LOW);
+}
+#endif
+
+// Private Methods /////////////////////////////////////////////////////////////
+// Functions only available to other functions in this library
+#if defined(ACE128_EEPROM_JOURNAL)
+// EEPROM journal
+// The EEPROM area at _eeAddr is a ring of ACE128_EEPROM_JOURNAL records of 4 bytes:
+//   _mpos low byte, _mpos high byte, _zero, sequence number
+// Each save goes to the slot after the newest with the next sequence number, so the writes are spread over
+// the whole ring. Sequence numbers run 0 - 254 and wrap. 255 is what blank EEPROM reads, so it marks an empty slot.
+// The sequence number is written last so a save interrupted by power loss leaves the previous record newest.
+
+#define ACE128_EEPROM_SEQ_NEXT(seq) ((seq) >= 254 ? 0 : (seq) + 1)
+
+// find the newest record and read _mpos and _zero from it
+// the newest record is the one whose successor does not carry the next sequence number
+boolean ACE128::_eeprom_read_settings()
+{
+  uint8_t rec[4];
+  uint8_t first, seq, next;
+  _eeprom_read(_eeAddr + 3, &first, 1);
+  seq = first;
+  for (uint8_t slot = 0; slot < ACE128_EEPROM_JOURNAL; slot++)
+  {
+    if (slot + 1 < ACE128_EEPROM_JOURNAL)
+    {
+      _eeprom_read(_eeAddr + (slot + 1) * 4 + 3, &next, 1);
+    }
+    else
+    {
+      next = first;  // ring wraps
+    }
+    if (seq != 0xFF && next != ACE128_EEPROM_SEQ_NEXT(seq))
+    {
+      _eeprom_read(_eeAddr + slot * 4, rec, 4);
+      _mpos = rec[0] | (rec[1] << 8);
+      _zero = rec[2] & 0x7f;
+      _eeSlot = slot;
+      _eeSeq = seq;
+      _eeMpos = _mpos;
+      _eeDirty = false;
+      _eeWritten = millis();
+      return (true);
+    }
+    seq = next;
+  }
+  // blank - start the ring so the first save lands in slot 0
+  _eeSlot = ACE128_EEPROM_JOURNAL - 1;
+  _eeSeq = 254;
+  _eeMpos = 0;
+  _eeDirty = false;
+  _eeWritten = millis();
+  return (false);
+}
+
+// called on every multiturn update
+// notes when the turn count changes and saves it once it has settled, or has been unsaved for too long
+void ACE128::_eeprom_write_mpos()
+{
+  unsigned long now = millis();
+  if (_mpos != _eeMpos)
+  {
+    _eeMpos = _mpos;
+    _eeChanged = now;
+    _eeDirty = true;
+  }
+  if (_eeDirty && (now - _eeChanged >= ACE128_EEPROM_IDLE_MS || now - _eeWritten >= ACE128_EEPROM_MAX_MS))
+  {
+    _eeprom_write_record();
+  }
+}
+
+// zero only changes when the user asks, so save it straight away
+void ACE128::_eeprom_write_zero()
+{
+  _eeprom_write_record();
+}
+
+// save any held back multiturn state now, e.g. before a planned power down
+void ACE128::flush()
+{
+  if (_eeAddr >= 0)
+  {
+    _eeprom_write_mpos();  // pick up a turn change we haven't looked at yet
+    if (_eeDirty)
+    {
+      _eeprom_write_record();
+    }
+  }
+}
+
+// write the current state to the slot after the newest
+void ACE128::_eeprom_write_record()
+{
+  _eeSlot = (_eeSlot + 1 >= ACE128_EEPROM_JOURNAL) ? 0 : _eeSlot + 1;
+  _eeSeq = ACE128_EEPROM_SEQ_NEXT(_eeSeq);
+  uint16_t eeAddr = _eeAddr + _eeSlot * 4;
+  #if defined(ACE128_EEPROM_I2C)
+  Wire.beginTransmission(ACE128_EEPROM_ADDR);  // one page write, the chip commits all 4 bytes together
+  Wire.write((uint8_t) (eeAddr >> 8));
+  Wire.write((uint8_t) eeAddr );
+  Wire.write((uint8_t) _mpos );
+  Wire.write((uint8_t) (_mpos >> 8));
+  Wire.write((uint8_t) _zero );
+  Wire.write((uint8_t) _eeSeq );
+  Wire.endTransmission();
+  #elif defined(ACE128_EEPROM_AVR)
+  EEPROM.update(eeAddr, (uint8_t) _mpos);
+  EEPROM.update(eeAddr + 1, (uint8_t) (_mpos >> 8));
+  EEPROM.update(eeAddr + 2, _zero);
+  EEPROM.write(eeAddr + 3, _eeSeq);            // last, see above
+  #endif
+  ACE128_COUNT(eepromWrites);
+  _eeMpos = _mpos;
+  _eeDirty = false;
+  _eeWritten = millis();
+}
+
+// read len bytes starting at addr
+void ACE128::_eeprom_read(uint16_t addr, uint8_t *buf, uint8_t len)
+{
+  #if defined(ACE128_EEPROM_I2C)
+  Wire.beginTransmission(ACE128_EEPROM_ADDR);
+  Wire.write((uint8_t) (addr >> 8));
+  Wire.write((uint8_t) addr );
+  Wire.endTransmission(false);
+  Wire.requestFrom(ACE128_EEPROM_ADDR, (int)len);
+  while (len--) *buf++ = Wire.read();
+  #elif defined(ACE128_EEPROM_AVR)
+  while (len--) *buf++ = EEPROM.read(addr++);
+  #endif
+}
+#elif !defined(ACE128_EEPROM_NONE)
+// read _mpos and _zero from
+boolean ACE128::_eeprom_read_settings()
+{
+  #if defined(ACE128_EEPROM_I2C)
   Wire.beginTransmission(ACE128_EEPROM_ADDR);
   Wire.write((uint8_t) (_eeAddr >> 8));
   Wire.write((uint8_t) _eeAddr );
@@ -418,6 +2205,7 @@ void ACE128::_eeprom_read_settings()
   EEPROM.get(_eeAddr, _mpos);
   EEPROM.get(_eeAddr + sizeof(_mpos), _zero);
   #endif
+  return (true);  // no way to tell a blank EEPROM from a saved state
 }
 
 // I2C EEPROM write functions are very simple to suit this application
@@ -435,7 +2223,13 @@ void ACE128::_eeprom_write_mpos()
   Wire.write((uint8_t) _mpos );
   Wire.write((uint8_t) (_mpos >> 8));
   Wire.endTransmission();
+  ACE128_COUNT(eepromWrites);
   #elif defined(ACE128_EEPROM_AVR)
+    #ifdef ACE128_STATS
+  int16_t saved;
+  EEPROM.get(_eeAddr, saved);
+  if (saved != _mpos) ACE128_COUNT(eepromWrites);  // put() only writes the bytes that differ
+    #endif
   EEPROM.put(_eeAddr, _mpos);
   #endif
 }
@@ -443,18 +2237,20 @@ void ACE128::_eeprom_write_mpos()
 // write _zero to eeprom
 void ACE128::_eeprom_write_zero()
 {
-  uint16_t eeAddr = eeAddr + sizeof(_mpos);
+  uint16_t eeAddr = _eeAddr + sizeof(_mpos);
   #if defined(ACE128_EEPROM_I2C)
   Wire.beginTransmission(ACE128_EEPROM_ADDR);
   Wire.write((uint8_t) (eeAddr >> 8));
   Wire.write((uint8_t) eeAddr );
   Wire.write((uint8_t) _zero );
   Wire.endTransmission();
+  ACE128_COUNT(eepromWrites);
   #elif defined(ACE128_EEPROM_AVR)
+  if (EEPROM.read(eeAddr) != _zero) ACE128_COUNT(eepromWrites);
   EEPROM.update(eeAddr, _zero);
   #endif
 }
 
-#endif // ACE128_EEPROM_NONE
+#endif // ACE128_EEPROM_JOURNAL
 
 #endif // ACE128_h
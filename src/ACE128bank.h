@@ -0,0 +1,227 @@
+#ifndef ACE128bank_h
+#define ACE128bank_h
+/*
+  ACE128bank.h - many I2C ACE128 encoders in as little RAM as possible
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  An ACE128 object holds its own map pointer, bus address, chip type, zero, direction, multiturn offset and
+  last position, which is 12 bytes or more each on AVR. ACE128bank<N> keeps the same state for N encoders
+  that share one map as packed arrays:
+    zero and reverse            1 byte  - 7 bit zero, reverse in bit 7
+    multiturn position          2 bytes - the last position is its low 7 bits, so it isn't kept separately
+    address                     4 bits  - PCF8574A range bit and the 3 address bits, two encoders to a byte
+    MCP23008 flag               1 bit
+  That is 3.625 bytes per encoder, 29 bytes for every 8, plus one map pointer for the bank - 118 bytes for 32
+  encoders on AVR. ACE128_BANK_BYTES(n) gives the figure and a static_assert below holds the class to it.
+
+  Usage:
+    ACE128bank<32> panel((uint8_t*)encoderMap_87654321);
+    setup():  for (uint8_t n = 0; n < 8; n++) { panel.set(n, 0x20 + n); panel.set(n + 8, 0x38 + n); ... } panel.begin();
+    loop():   panel.update(); then panel.mpos(n), panel.pos(n), panel.upos(n) - these don't touch the bus
+
+  Addresses are as for ACE128: 0x00 - 0x07 MCP23008, 0x20 - 0x27 PCF8574, 0x38 - 0x3F PCF8574A. Every encoder
+  must be set() before begin(). The MCP23008s are left pointing at GPIO by begin(), so every read is a single
+  requestFrom() whatever the chip. There is no EEPROM saving, multiplexer or interrupt support - save getZero(n)
+  and mpos(n) yourself and restore them with setZero(n, zero) and setMpos(n, mpos) if you need them.
+*/
+
+#include "ACE128.h"
+#include "ACE128wire.h"
+
+// RAM used by a bank of n encoders, not counting padding the compiler may add off AVR
+#define ACE128_BANK_BYTES(n) ((n) * 3 + ((n) + 1) / 2 + ((n) + 7) / 8 + sizeof(uint8_t *))
+
+template <uint8_t N>
+class ACE128bank
+{
+  public:
+    ACE128bank(uint8_t *map);      // map table in PROGMEM shared by every encoder
+    void set(uint8_t n, uint8_t i2caddr); // bus address of encoder n, call before begin()
+    void begin();                  // start the bus, set up the chips, zero each encoder where it is
+    void update();                 // read every encoder once, in order
+    void update(uint8_t n);        // read encoder n
+    uint8_t upos(uint8_t n);       // logical position 0 -> 127 at the last update
+    int8_t pos(uint8_t n);         // logical position -64 -> +63 at the last update
+    int16_t mpos(uint8_t n);       // multiturn position at the last update
+    void setMpos(uint8_t n, int16_t mPos); // sets current position to multiturn value - also changes zero
+    void setZero(uint8_t n);       // sets logical zero to current position
+    void setZero(uint8_t n, uint8_t rawPos); // sets logical zero position
+    uint8_t getZero(uint8_t n);    // returns logical zero position
+    void reverse(uint8_t n, boolean reverse); // set counter-clockwise operation
+    uint8_t rawPos(uint8_t n);     // reads encoder n, returns raw mechanical position
+    uint8_t count();               // N
+  private:
+    uint8_t *_map;                 // PROGMEM map table
+    int16_t _mpos[N];              // multiturn position at the last update
+    uint8_t _zr[N];                // bits 0 - 6 zero, bit 7 reverse
+    uint8_t _addr[(N + 1) / 2];    // per encoder nibble: bit 3 PCF8574A range, bits 0 - 2 address
+    uint8_t _mcp[(N + 7) / 8];     // per encoder bit: MCP23008
+    uint8_t _i2caddr(uint8_t n);   // full bus address of encoder n
+    boolean _isMcp(uint8_t n);
+    int8_t _raw2pos(uint8_t n, uint8_t raw);
+};
+
+// hold the class to the documented size
+static_assert(sizeof(ACE128bank<32>) <= (ACE128_BANK_BYTES(32) + alignof(uint8_t *) - 1) / alignof(uint8_t *) * alignof(uint8_t *),
+              "ACE128bank is bigger than ACE128_BANK_BYTES says");
+
+template <uint8_t N>
+ACE128bank<N>::ACE128bank(uint8_t *map)
+{
+  _map = map;
+  for (uint8_t n = 0; n < N; n++)
+  {
+    _mpos[n] = 0;
+    _zr[n] = 0;
+  }
+  for (uint8_t i = 0; i < (N + 1) / 2; i++) _addr[i] = 0;
+  for (uint8_t i = 0; i < (N + 7) / 8; i++) _mcp[i] = 0;
+}
+
+template <uint8_t N>
+void ACE128bank<N>::set(uint8_t n, uint8_t i2caddr)
+{
+  uint8_t nibble = i2caddr & 0x07;
+  if ((i2caddr & 0x78) == ACE128_PCF8574A_ADDRESS)
+  {
+    nibble |= 0x08;
+  }
+  if ((i2caddr & 0x78) == ACE128_PCF8574_ADDRESS || (i2caddr & 0x78) == ACE128_PCF8574A_ADDRESS)
+  {
+    _mcp[n >> 3] &= ~(1 << (n & 7));
+  }
+  else
+  {
+    _mcp[n >> 3] |= 1 << (n & 7);  // 0x00 - 0x07 as with ACE128
+  }
+  _addr[n >> 1] = (n & 1) ? (_addr[n >> 1] & 0x0F) | (nibble << 4) : (_addr[n >> 1] & 0xF0) | nibble;
+}
+
+template <uint8_t N>
+uint8_t ACE128bank<N>::_i2caddr(uint8_t n)
+{
+  uint8_t nibble = (_addr[n >> 1] >> ((n & 1) * 4)) & 0x0F;
+  return ((nibble & 0x07) | ((nibble & 0x08) ? ACE128_PCF8574A_ADDRESS : ACE128_PCF8574_ADDRESS));
+}
+
+template <uint8_t N>
+boolean ACE128bank<N>::_isMcp(uint8_t n)
+{
+  return ((_mcp[n >> 3] >> (n & 7)) & 1);
+}
+
+template <uint8_t N>
+void ACE128bank<N>::begin()
+{
+  Wire.begin();
+  for (uint8_t n = 0; n < N; n++)
+  {
+    uint8_t addr = _i2caddr(n);
+    if (_isMcp(n))
+    {
+      ACE128_mcp23008_begin(addr);  // leaves it pointing at GPIO
+    }
+    else
+    {
+      Wire.beginTransmission(addr);
+      Wire.write((uint8_t)0xFF);  // set all pins up. pulldown for input
+      Wire.endTransmission();
+    }
+    _zr[n] = (_zr[n] & 0x80) | (rawPos(n) & 0x7F); // set zero to where we happen to be
+    _mpos[n] = 0;
+  }
+}
+
+template <uint8_t N>
+uint8_t ACE128bank<N>::rawPos(uint8_t n)
+{
+  Wire.requestFrom((int)_i2caddr(n), 1);
+  return (pgm_read_byte(_map + (uint8_t)Wire.read()));
+}
+
+template <uint8_t N>
+int8_t ACE128bank<N>::_raw2pos(uint8_t n, uint8_t raw)
+{
+  return (ACE128math::raw2pos(raw, _zr[n] & 0x7F, _zr[n] & 0x80));
+}
+
+// the last position is the low 7 bits of _mpos, as the turn offset is always a multiple of 128
+template <uint8_t N>
+void ACE128bank<N>::update(uint8_t n)
+{
+  int8_t pos = _raw2pos(n, rawPos(n));
+  int8_t lastpos = this->pos(n);
+  _mpos[n] += pos - lastpos + ACE128math::rollover(lastpos, pos);
+}
+
+template <uint8_t N>
+void ACE128bank<N>::update()
+{
+  for (uint8_t n = 0; n < N; n++)
+  {
+    update(n);
+  }
+}
+
+template <uint8_t N>
+int16_t ACE128bank<N>::mpos(uint8_t n)
+{
+  return (_mpos[n]);
+}
+
+template <uint8_t N>
+int8_t ACE128bank<N>::pos(uint8_t n)
+{
+  uint8_t low = _mpos[n] & 0x7F;
+  return ((low & 0x40) ? (int8_t)(low | 0x80) : (int8_t)low);
+}
+
+template <uint8_t N>
+uint8_t ACE128bank<N>::upos(uint8_t n)
+{
+  return (_mpos[n] & 0x7F);
+}
+
+template <uint8_t N>
+void ACE128bank<N>::setMpos(uint8_t n, int16_t mPos)
+{
+  uint8_t rawpos = rawPos(n);
+  _zr[n] = (_zr[n] & 0x80) | ACE128math::zeroFor(rawpos, mPos);
+  int8_t pos = _raw2pos(n, rawpos);
+  _mpos[n] = ACE128math::turnsFor(mPos, pos) + pos;
+}
+
+template <uint8_t N>
+void ACE128bank<N>::setZero(uint8_t n, uint8_t rawPos)
+{
+  int16_t turns = _mpos[n] - pos(n);
+  _zr[n] = (_zr[n] & 0x80) | (rawPos & 0x7F);
+  _mpos[n] = turns + _raw2pos(n, rawPos);  // as if the knob were at the new zero until the next update
+}
+
+template <uint8_t N>
+void ACE128bank<N>::setZero(uint8_t n)
+{
+  setZero(n, rawPos(n));
+}
+
+template <uint8_t N>
+uint8_t ACE128bank<N>::getZero(uint8_t n)
+{
+  return (_zr[n] & 0x7F);
+}
+
+template <uint8_t N>
+void ACE128bank<N>::reverse(uint8_t n, boolean reverse)
+{
+  _zr[n] = reverse ? (_zr[n] | 0x80) : (_zr[n] & 0x7F);
+}
+
+template <uint8_t N>
+uint8_t ACE128bank<N>::count()
+{
+  return (N);
+}
+
+#endif // ACE128bank_h
@@ -0,0 +1,291 @@
+#ifndef ACE128calibrate_h
+#define ACE128calibrate_h
+/*
+  ACE128calibrate.h - work out how an ACE-128 is wired by watching it turn
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  For wirings none of the shipped maps cover, instead of editing make_encodermap, running it and pasting its output
+  into a new header: turn the knob while update() watches acePins(), and it finds which ACE-128 pin is on each
+  expander pin. The result is an 8 byte pin order, which can be saved to EEPROM, and from which makeMap() builds
+  the 256 byte map in RAM at startup. With ACE128_COMPACT_MAP the 8 byte order is all the encoder needs.
+  The map or order lives in RAM, so #define ACE128_RAM_MAP in ACE128.h and tell the encoder with setMap(). Other
+  encoders in the sketch keep their PROGMEM maps.
+
+  Usage:
+    uint8_t knobMap[256];                      // uint8_t knobOrder[8] = { 1, 2, 3, 4, 5, 6, 7, 8 } with
+    ACE128 knob(0x20, knobMap);                // ACE128_COMPACT_MAP - any order will do until getOrder()
+    setup():
+      memset(knobMap, 0xFF, sizeof(knobMap));  // no valid codes yet - begin() reads the knob through the map
+      knob.setMap(knobMap, true);              // in RAM
+      knob.begin();
+      ACE128calibrate cal(knob);
+      if (!cal.load(0)) {                      // nothing saved at EEPROM address 0
+        while (cal.update() == ACE128_CAL_TURNING) ;  // ask the user to turn the knob a full turn
+        cal.save(0);
+      }
+      cal.makeMap(knobMap);                    // or cal.getOrder(knobOrder)
+      knob.setMpos(0);                         // zero here, counting from the new map
+
+  Each pin reads the same track 16 positions on from the one before, so turning every pin number up by one gives
+  the same codes 16 positions further round. Codes alone can't tell those 8 orders apart - the knob works the same
+  with any of them, only its raw positions differ by a multiple of 16, and the logical zero hides that. Where one of
+  the 8 is a shipped wiring that one is chosen, so the author's modules come out as encoderMap_87654321 exactly.
+  Some shipped wirings read the same as each other - 12348765 and 56784321, and 18762345, 54326781 and 87651234 -
+  and the first of those in ACE128_shippedOrders wins.
+  A code only counts once it has been read twice running, so torn reads are left out. The knob is first read by the
+  first update(), not when the calibrator is made. update() looks for the order once it has ACE128_CALIBRATE_CODES
+  different codes and again every 16 more until only one order is left, or all 128 have been seen. Each look
+  tries up to 5040 orders, about a second's work on a 16MHz AVR, so it is spread over many update() calls,
+  ACE128_CALIBRATE_STEP orders at a time, and a sketch can keep its display and other knobs going while it runs.
+*/
+
+#include "ACE128.h"
+#include "ACE128map.h"
+
+// Use these preprocessor #define statements to configure calibration
+#ifndef ACE128_CALIBRATE_CODES
+  #define ACE128_CALIBRATE_CODES 64  // codes to see before the first attempt, half a turn. At most 128
+#endif
+#ifndef ACE128_CALIBRATE_STEP
+  #define ACE128_CALIBRATE_STEP 8    // orders to try per update(), up to ~200us each on a 16MHz AVR
+#endif
+
+// update() results
+#define ACE128_CAL_TURNING 0         // keep turning
+#define ACE128_CAL_DONE    1         // pin order found
+#define ACE128_CAL_FAILED  2         // no pin order gives the codes seen - not an ACE-128, or bad wiring
+
+// shipped wirings, preferred over the other orders that read the same
+PROGMEM const uint8_t ACE128_shippedOrders[7][8] = {
+  { 8, 7, 6, 5, 4, 3, 2, 1 }, { 1, 2, 3, 4, 5, 6, 7, 8 }, { 1, 2, 3, 4, 8, 7, 6, 5 }, { 1, 8, 7, 6, 2, 3, 4, 5 },
+  { 5, 4, 3, 2, 6, 7, 8, 1 }, { 5, 6, 7, 8, 4, 3, 2, 1 }, { 8, 7, 6, 5, 1, 2, 3, 4 }
+};
+
+class ACE128calibrate
+{
+  public:
+    ACE128calibrate(ACE128 &encoder);
+    uint8_t update();              // read the pins once, returns ACE128_CAL_ status
+    uint8_t seen();                // different codes seen so far, out of 128
+    boolean getOrder(uint8_t *order); // copy the 8 byte pin order to RAM, false if not found yet
+    boolean makeMap(uint8_t *map); // build the 256 byte map in RAM, false if the order isn't found yet
+#ifndef ACE128_EEPROM_NONE
+    void save(int16_t eeAddr);     // save the pin order to 8 bytes of EEPROM - keep I2C addresses a multiple of 8
+    boolean load(int16_t eeAddr);  // read it back, false if there is no pin order there
+#endif
+  private:
+    ACE128 *_enc;
+    uint8_t _seen[32];             // bit per code seen
+    uint8_t _valid[32];            // bit per code the ACE-128 gives with pins 1 - 8 on P0 - P7
+    uint8_t _order[8];             // ACE-128 pin on each of P0 - P7
+    uint8_t _count;                // codes seen
+    uint8_t _next;                 // codes to see before the next attempt
+    uint8_t _last;                 // last reading
+    boolean _started;              // _last has been read
+    uint8_t _status;
+    uint8_t _try[8];               // next order to try in the search under way
+    uint8_t _found;                // orders that fit so far in this search
+    uint8_t _from;                 // codes seen when this search started
+    boolean _searching;            // a search is under way
+    boolean _fits(const uint8_t *order); // every code seen is valid with this order
+    boolean _nextOrder();          // move _try on to the next order, false after the last
+    uint8_t _solve();              // carry on searching, ACE128_CAL_ status
+    void _prefer();                // turn _order into a shipped wiring if one reads the same
+};
+
+ACE128calibrate::ACE128calibrate(ACE128 &encoder)
+{
+  _enc = &encoder;
+  for (uint8_t i = 0; i < 32; i++)
+  {
+    _seen[i] = 0;
+    _valid[i] = 0;
+  }
+  for (uint8_t pos = 0; pos < 128; pos++)
+  {
+    uint8_t code = 0;
+    for (uint8_t pin = 1; pin <= 8; pin++)
+    {
+      code |= ACE128_pinbit(pos, pin) << (pin - 1);
+    }
+    _valid[code >> 3] |= 1 << (code & 7);
+  }
+  _count = 0;
+  _next = (ACE128_CALIBRATE_CODES < 128) ? ACE128_CALIBRATE_CODES : 128;
+  _last = 0;
+  _started = false;                // no bus traffic until update()
+  _status = ACE128_CAL_TURNING;
+  _searching = false;
+}
+
+uint8_t ACE128calibrate::update()
+{
+  if (_status != ACE128_CAL_TURNING) return (_status);
+  uint8_t pins = _enc->acePins();
+  if (_started && pins == _last && !(_seen[pins >> 3] & (1 << (pins & 7))))
+  {
+    _seen[pins >> 3] |= 1 << (pins & 7);
+    _count++;
+  }
+  _last = pins;
+  _started = true;
+  if (!_searching && _count >= _next)
+  {
+    for (uint8_t i = 0; i < 8; i++) _try[i] = i + 1;
+    _found = 0;
+    _from = _count;
+    _next = (_next < 128 - 16) ? _next + 16 : 128;  // the last look is with every code in
+    _searching = true;
+  }
+  if (_searching) _status = _solve();
+  return (_status);
+}
+
+uint8_t ACE128calibrate::seen()
+{
+  return (_count);
+}
+
+boolean ACE128calibrate::_fits(const uint8_t *order)
+{
+  for (uint16_t pins = 0; pins < 256; pins++)
+  {
+    if (!(_seen[pins >> 3] & (1 << (pins & 7)))) continue;
+    uint8_t code = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      if (pins & (1 << i)) code |= 1 << (order[i] - 1);
+    }
+    if (!(_valid[code >> 3] & (1 << (code & 7)))) return (false);
+  }
+  return (true);
+}
+
+// Try every order with pin 1 on P0 - one from each set of 8 that read the same - 5040 of them, in lexical order,
+// ACE128_CALIBRATE_STEP a call. Most wrong orders fail on one of the first few codes. Codes seen since the search
+// started only rule orders out, so an order that failed earlier still fails, and the one left at the end is checked
+// again against them all.
+uint8_t ACE128calibrate::_solve()
+{
+  for (uint8_t n = 0; n < ACE128_CALIBRATE_STEP; n++)
+  {
+    if (_fits(_try))
+    {
+      if (_found++)                // more than one - keep turning and look again later
+      {
+        _searching = false;
+        return (_from >= 128 ? ACE128_CAL_FAILED : ACE128_CAL_TURNING);
+      }
+      for (uint8_t i = 0; i < 8; i++) _order[i] = _try[i];
+    }
+    if (!_nextOrder())
+    {
+      _searching = false;
+      if (_found == 0 || !_fits(_order)) return (ACE128_CAL_FAILED);
+      _prefer();
+      return (ACE128_CAL_DONE);
+    }
+  }
+  return (ACE128_CAL_TURNING);
+}
+
+// next permutation of _try[1..7]
+boolean ACE128calibrate::_nextOrder()
+{
+  int8_t i = 6;
+  while (i >= 1 && _try[i] >= _try[i + 1]) i--;
+  if (i < 1) return (false);
+  int8_t j = 7;
+  while (_try[j] <= _try[i]) j--;
+  uint8_t t = _try[i]; _try[i] = _try[j]; _try[j] = t;
+  for (int8_t a = i + 1, b = 7; a < b; a++, b--)
+  {
+    t = _try[a]; _try[a] = _try[b]; _try[b] = t;
+  }
+  return (true);
+}
+
+void ACE128calibrate::_prefer()
+{
+  for (uint8_t s = 0; s < 7; s++)
+  {
+    uint8_t turn = (pgm_read_byte(&ACE128_shippedOrders[s][0]) + 8 - _order[0]) % 8;
+    uint8_t i = 0;
+    for (; i < 8; i++)
+    {
+      if (pgm_read_byte(&ACE128_shippedOrders[s][i]) != (_order[i] - 1 + turn) % 8 + 1) break;
+    }
+    if (i == 8)
+    {
+      for (i = 0; i < 8; i++) _order[i] = (_order[i] - 1 + turn) % 8 + 1;
+      return;
+    }
+  }
+}
+
+boolean ACE128calibrate::getOrder(uint8_t *order)
+{
+  if (_status != ACE128_CAL_DONE) return (false);
+  for (uint8_t i = 0; i < 8; i++) order[i] = _order[i];
+  return (true);
+}
+
+// what make_encodermap does, for our order
+boolean ACE128calibrate::makeMap(uint8_t *map)
+{
+  if (_status != ACE128_CAL_DONE) return (false);
+  for (uint16_t pins = 0; pins < 256; pins++) map[pins] = 0xFF;
+  for (uint8_t pos = 0; pos < 128; pos++)
+  {
+    uint8_t pins = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      pins |= ACE128_pinbit(pos, _order[i]) << i;
+    }
+    map[pins] = pos;
+  }
+  return (true);
+}
+
+#ifndef ACE128_EEPROM_NONE
+void ACE128calibrate::save(int16_t eeAddr)
+{
+  #if defined(ACE128_EEPROM_I2C)
+  Wire.beginTransmission(ACE128_EEPROM_ADDR);  // one page write
+  Wire.write((uint8_t) (eeAddr >> 8));
+  Wire.write((uint8_t) eeAddr );
+  for (uint8_t i = 0; i < 8; i++) Wire.write(_order[i]);
+  Wire.endTransmission();
+  #elif defined(ACE128_EEPROM_AVR)
+  for (uint8_t i = 0; i < 8; i++) EEPROM.update(eeAddr + i, _order[i]);
+  #endif
+}
+
+boolean ACE128calibrate::load(int16_t eeAddr)
+{
+  uint8_t order[8];
+  #if defined(ACE128_EEPROM_I2C)
+  Wire.beginTransmission(ACE128_EEPROM_ADDR);
+  Wire.write((uint8_t) (eeAddr >> 8));
+  Wire.write((uint8_t) eeAddr );
+  Wire.endTransmission(false);
+  Wire.requestFrom(ACE128_EEPROM_ADDR, 8);
+  for (uint8_t i = 0; i < 8; i++) order[i] = Wire.read();
+  #elif defined(ACE128_EEPROM_AVR)
+  for (uint8_t i = 0; i < 8; i++) order[i] = EEPROM.read(eeAddr + i);
+  #endif
+  uint16_t pins = 0;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    if (order[i] < 1 || order[i] > 8) return (false);
+    pins |= 1 << order[i];
+  }
+  if (pins != 0x1FE) return (false);  // blank or something else - each pin must be there once
+  for (uint8_t i = 0; i < 8; i++) _order[i] = order[i];
+  _status = ACE128_CAL_DONE;
+  return (true);
+}
+#endif
+
+#endif // ACE128calibrate_h
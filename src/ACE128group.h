@@ -0,0 +1,271 @@
+#ifndef ACE128group_h
+#define ACE128group_h
+/*
+  ACE128group.h - read a panel of ACE128 encoders in one ordered scan
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Calling begin() on each ACE128 restarts the bus every time, and reading each knob whenever the sketch
+  gets round to it makes the time between reads of any one knob hard to predict on a big panel.
+  ACE128group starts the bus once at the clock you ask for, reads every encoder in the order they were added,
+  and keeps the results of the last complete scan as a snapshot, so every value in it comes from the same pass.
+  The encoders can be any mix of PCF8574, PCF8574A and MCP23008.
+
+  Usage:
+    ACE128 knob1(0x20, (uint8_t*)encoderMap_87654321);
+    ACE128 knob2(0x01, (uint8_t*)encoderMap_87654321);  // MCP23008
+    ACE128group panel;
+    setup():  panel.add(knob1); panel.add(knob2); panel.begin(400000);  // no knob.begin() calls
+    loop():   if (panel.scan()) { use panel.sample(0).mpos, panel.sample(1).mpos ... }
+
+  With ACE128_MUX the encoders are read main bus first, then channel by channel, so each multiplexer channel is
+  switched to once per scan however many encoders are on it.
+  The PCF8574 and PCF8574A are only rated for 100kHz. Leave the clock alone if the panel has any of those.
+  With setBudget(us) a scan() call stops before it would run over the budget and the next call carries on
+  where it left off, so a long panel spreads over several loop() passes. The snapshot only changes when a scan completes.
+*/
+
+#include "ACE128.h"
+
+// Use these preprocessor #define statements to configure the group
+#ifndef ACE128_GROUP_MAX
+  #define ACE128_GROUP_MAX 16       // most encoders one group can hold, up to 24 with all three chip types
+#endif
+
+class ACE128group
+{
+  public:
+    ACE128group();
+    uint8_t add(ACE128 &encoder);  // register an encoder, returns its index or 0xFF if full
+    void begin(uint32_t clock = 100000); // start the bus, begin every encoder and take a first full scan
+    boolean scan();                // read on through the encoders, true when a scan completed and the snapshot changed
+    void setBudget(uint16_t us);   // most micros() one scan() call may take, 0 for no limit
+    const ACE128sample &sample(uint8_t n); // encoder n as of the last complete scan
+    const ACE128sample *snapshot();  // the whole last complete scan, in add() order
+    unsigned long scanTime();      // micros() spent reading during the last complete scan
+    uint8_t count();               // number of registered encoders
+#ifdef ACE128_STATS
+    ACE128stats stats();           // every encoder's counters added together
+    void resetStats();             // clear every encoder's counters
+#endif
+  private:
+    ACE128 *_enc[ACE128_GROUP_MAX]; // registered encoders
+    ACE128sample _snap[ACE128_GROUP_MAX]; // last complete scan
+    ACE128sample _work[ACE128_GROUP_MAX]; // scan in progress
+    uint8_t _count;                // number of registered encoders
+    uint8_t _next;                 // next encoder to read
+#ifdef ACE128_MUX
+    uint8_t _order[ACE128_GROUP_MAX]; // read order, main bus first then by multiplexer channel
+#endif
+    uint16_t _budget;              // micros() per scan() call, 0 for no limit
+    uint16_t _readTime;            // micros() the last read took - used to stop short of the budget
+    unsigned long _scanTime;       // micros() spent on the last complete scan
+    unsigned long _workTime;       // micros() spent so far on the scan in progress
+    uint8_t _index(uint8_t i);     // encoder to read i'th in a scan
+#ifdef ACE128_WIRE_BATCH
+    boolean _scanBatch();          // scan() with as few Wire batches as possible
+    void _batchDone(uint8_t from, uint8_t to); // send the batch, decode the encoders from..to-1 in it
+#endif
+};
+
+ACE128group::ACE128group()
+{
+  _count = 0;
+  _next = 0;
+  _budget = 0;
+  _readTime = 0;
+  _scanTime = 0;
+  _workTime = 0;
+}
+
+uint8_t ACE128group::add(ACE128 &encoder)
+{
+  if (_count >= ACE128_GROUP_MAX) return (0xFF);
+  _enc[_count] = &encoder;
+  return (_count++);
+}
+
+void ACE128group::begin(uint32_t clock)
+{
+#ifdef ACE128_I2C
+  Wire.begin();                    // once for the whole panel
+  Wire.setClock(clock);
+#else
+  (void)clock;                     // no bus
+#endif
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    _enc[n]->_begin();
+  }
+#ifdef ACE128_MUX
+  // sort by channel, keeping add() order within a channel, so each channel is opened once per scan
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    uint8_t i = n;
+    for (; i > 0 && _enc[_order[i - 1]]->_mux > _enc[n]->_mux; i--)
+    {
+      _order[i] = _order[i - 1];
+    }
+    _order[i] = n;
+  }
+#endif
+  uint16_t budget = _budget;
+  _budget = 0;                     // the first scan always runs through so the snapshot is good from the start
+  _next = 0;
+  _workTime = 0;
+  scan();
+  _budget = budget;
+}
+
+uint8_t ACE128group::_index(uint8_t i)
+{
+#ifdef ACE128_MUX
+  return (_order[i]);
+#else
+  return (i);
+#endif
+}
+
+boolean ACE128group::scan()
+{
+  if (_count == 0) return (false);
+#ifdef ACE128_WIRE_BATCH
+  return (_scanBatch());
+#endif
+  unsigned long start = micros();
+  unsigned long t = start;
+  do
+  {
+    uint8_t n = _index(_next);
+    _work[n] = _enc[n]->sample();
+    unsigned long now = micros();
+    _readTime = now - t;
+    t = now;
+    if (++_next >= _count)
+    {
+      _workTime += t - start;
+      _scanTime = _workTime;
+      _workTime = 0;
+      _next = 0;
+      for (uint8_t n = 0; n < _count; n++)
+      {
+        _snap[n] = _work[n];
+      }
+      return (true);
+    }
+  } while (_budget == 0 || t - start + _readTime <= _budget);
+  _workTime += t - start;
+  return (false);
+}
+
+#ifdef ACE128_WIRE_BATCH
+// the whole panel in one batch, as long as it fits and needs no multiplexer switch - the TCA9548A only
+// switches at a STOP, so each channel gets its own batch. The budget doesn't apply
+boolean ACE128group::_scanBatch()
+{
+  unsigned long start = micros();
+  uint8_t first = 0;
+  Wire.batchBegin();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    uint8_t n = _index(i);
+  #ifdef ACE128_MUX
+    if (_enc[n]->_mux >= 0 && ACE128::_muxOpen != (uint8_t)(1 << _enc[n]->_mux))
+    {
+      _batchDone(first, i);
+      first = i;
+      _enc[n]->_muxSelect();
+    }
+  #endif
+    if (!_enc[n]->_batchQueue(&_work[n].pins))
+    {
+      _batchDone(first, i);
+      first = i;
+      _enc[n]->_batchQueue(&_work[n].pins);
+    }
+  }
+  _batchDone(first, _count);
+  _scanTime = micros() - start;
+  _next = 0;
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    _snap[n] = _work[n];
+  }
+  return (true);
+}
+
+void ACE128group::_batchDone(uint8_t from, uint8_t to)
+{
+  #ifdef ACE128_STATS
+  unsigned long start = micros();
+  #endif
+  boolean ok = Wire.batchEnd();
+  unsigned long ms = millis();
+  #ifdef ACE128_STATS
+  unsigned long us = micros() - start;
+  #endif
+  for (uint8_t i = from; i < to; i++)
+  {
+    uint8_t n = _index(i);
+  #ifdef ACE128_STATS
+    if (ok) _enc[n]->_statsRead(us);          // every encoder in the batch waited for all of it
+    else ACE128::_statsInc(_enc[n]->_stats.busErrors);
+  #endif
+    _work[n] = ok ? _enc[n]->_sample(_enc[n]->_batchPins(_work[n].pins), ms) : _enc[n]->sample(); // one by one if it failed
+  }
+}
+#endif
+
+void ACE128group::setBudget(uint16_t us)
+{
+  _budget = us;
+}
+
+const ACE128sample &ACE128group::sample(uint8_t n)
+{
+  return (_snap[n]);
+}
+
+const ACE128sample *ACE128group::snapshot()
+{
+  return (_snap);
+}
+
+unsigned long ACE128group::scanTime()
+{
+  return (_scanTime);
+}
+
+uint8_t ACE128group::count()
+{
+  return (_count);
+}
+
+#ifdef ACE128_STATS
+// sums stop at 65535 like the counters themselves
+ACE128stats ACE128group::stats()
+{
+  ACE128stats total = ACE128stats();
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    ACE128stats s = _enc[n]->stats();
+    uint16_t *from = (uint16_t *)&s;
+    uint16_t *to = (uint16_t *)&total;
+    for (uint8_t i = 0; i < sizeof(ACE128stats) / sizeof(uint16_t); i++)
+    {
+      to[i] = (from[i] > 0xFFFF - to[i]) ? 0xFFFF : to[i] + from[i];
+    }
+  }
+  return (total);
+}
+
+void ACE128group::resetStats()
+{
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    _enc[n]->resetStats();
+  }
+}
+#endif
+
+#endif // ACE128group_h
@@ -0,0 +1,101 @@
+#ifndef ACE128map_h
+#define ACE128map_h
+/*
+  ACE128map.h - compile time encoder maps for any pin order
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  This does at compile time what the make_encodermap example sketch does on a board.
+  ACE128map<8,7,6,5,4,3,2,1> is the encoder map for pin order 87654321, i.e. ACE-128 pin 8 on expander P0,
+  pin 7 on P1 and so on. Its table is the same 256 byte PROGMEM map as encoderMap_87654321, so
+
+    ACE128 myACE(0x20, (uint8_t*)ACE128map<8,7,6,5,4,3,2,1>::table);
+
+  works just like the shipped map header, and any other pin order works without generating a new header.
+  codes is the 128 byte inverse - the pin code for each raw position, and order is the 8 byte pin order.
+  code() and decode() are constexpr, so with a fixed pin byte the compiler can fold the lookup away.
+
+  The shipped tables are checked against this generator below by checksum, in every build, and byte for byte by
+  extras/sim/test_maps.cpp. encoderMap_12348765R is not a plain pin order - it only has 112 valid codes - so it has
+  no equivalent here.
+*/
+
+#include <Arduino.h>
+#ifndef pgm_read_byte
+  #include <avr/pgmspace.h>
+#endif
+
+// track binary data taken from p1 column on datasheet - same as make_encodermap
+constexpr uint8_t ACE128_track[16] = { 0xC0, 0x3F, 0xF0, 0x0F, 0xE0, 0x1F, 0xFF, 0xFF,
+                                       0xFF, 0x00, 0xFC, 0x03, 0x80, 0x78, 0x06, 0x01 };
+
+// ACE-128 pin (1 - 8) reading at raw position pos. Each pin is 16 positions behind the previous
+constexpr uint8_t ACE128_pinbit(uint8_t pos, uint8_t pin)
+{
+  return (ACE128_track[((pos + (pin - 1) * 16) & 0x7F) / 8] >> (7 - pos % 8)) & 1;
+}
+
+// index lists for building the tables, 0 .. N-1
+template <uint8_t... I> struct ACE128_seq {};
+template <unsigned N, uint8_t... I> struct ACE128_mkseq : ACE128_mkseq<N - 1, N - 1, I...> {};
+template <uint8_t... I> struct ACE128_mkseq<0, I...> { typedef ACE128_seq<I...> type; };
+
+template <class Map, class Codes, class Positions> struct ACE128_mapdata;
+template <class Map, uint8_t... I, uint8_t... J>
+struct ACE128_mapdata<Map, ACE128_seq<I...>, ACE128_seq<J...> >
+{
+  static const uint8_t table[256];  // pin code -> raw position, 0xFF for invalid codes
+  static const uint8_t codes[128];  // raw position -> pin code
+};
+template <class Map, uint8_t... I, uint8_t... J>
+const uint8_t ACE128_mapdata<Map, ACE128_seq<I...>, ACE128_seq<J...> >::table[256] PROGMEM = { Map::decode(I)... };
+template <class Map, uint8_t... I, uint8_t... J>
+const uint8_t ACE128_mapdata<Map, ACE128_seq<I...>, ACE128_seq<J...> >::codes[128] PROGMEM = { Map::code(J)... };
+
+// P0 - P7 are the ACE-128 pin numbers wired to expander pins P0 - P7
+template <uint8_t P0, uint8_t P1, uint8_t P2, uint8_t P3, uint8_t P4, uint8_t P5, uint8_t P6, uint8_t P7>
+struct ACE128map : ACE128_mapdata<ACE128map<P0, P1, P2, P3, P4, P5, P6, P7>,
+                                  typename ACE128_mkseq<256>::type, typename ACE128_mkseq<128>::type>
+{
+  static_assert((1 << P0 | 1 << P1 | 1 << P2 | 1 << P3 | 1 << P4 | 1 << P5 | 1 << P6 | 1 << P7) == 0x1FE,
+                "ACE128map pin order must use each of pins 1 - 8 once");
+
+  static const uint8_t order[8];    // the pin order itself, for ACE128_COMPACT_MAP
+
+  // pin code read at raw position pos
+  static constexpr uint8_t code(uint8_t pos)
+  {
+    return ACE128_pinbit(pos, P0)      | ACE128_pinbit(pos, P1) << 1 |
+           ACE128_pinbit(pos, P2) << 2 | ACE128_pinbit(pos, P3) << 3 |
+           ACE128_pinbit(pos, P4) << 4 | ACE128_pinbit(pos, P5) << 5 |
+           ACE128_pinbit(pos, P6) << 6 | ACE128_pinbit(pos, P7) << 7;
+  }
+
+  // raw position for a pin code, 0xFF if no position gives that code
+  static constexpr uint8_t decode(uint8_t pins, uint8_t pos = 0)
+  {
+    return pos > 127 ? 0xFF : code(pos) == pins ? pos : decode(pins, pos + 1);
+  }
+
+  // running checksum of codes, for comparing against the shipped tables
+  // codes fixes the whole table - every other entry is 0xFF
+  static constexpr uint16_t checksum(uint8_t pos = 0, uint16_t sum = 0)
+  {
+    return pos > 127 ? sum : checksum(pos + 1, (sum * 31UL + code(pos)) % 65521UL);
+  }
+};
+
+template <uint8_t P0, uint8_t P1, uint8_t P2, uint8_t P3, uint8_t P4, uint8_t P5, uint8_t P6, uint8_t P7>
+const uint8_t ACE128map<P0, P1, P2, P3, P4, P5, P6, P7>::order[8] PROGMEM = { P0, P1, P2, P3, P4, P5, P6, P7 };
+
+// the generator must reproduce the shipped maps. These sums were taken from the map headers - a quick guard, the
+// byte for byte comparison is extras/sim/test_maps.cpp
+static_assert(ACE128map<1,2,3,4,5,6,7,8>::checksum() == 25957, "ACE128map does not match encoderMap_12345678");
+static_assert(ACE128map<1,2,3,4,8,7,6,5>::checksum() == 19702, "ACE128map does not match encoderMap_12348765");
+static_assert(ACE128map<1,8,7,6,2,3,4,5>::checksum() == 26248, "ACE128map does not match encoderMap_18762345");
+static_assert(ACE128map<5,4,3,2,6,7,8,1>::checksum() == 47516, "ACE128map does not match encoderMap_54326781");
+static_assert(ACE128map<5,6,7,8,4,3,2,1>::checksum() == 37208, "ACE128map does not match encoderMap_56784321");
+static_assert(ACE128map<8,7,6,5,1,2,3,4>::checksum() == 43797, "ACE128map does not match encoderMap_87651234");
+static_assert(ACE128map<8,7,6,5,4,3,2,1>::checksum() == 32722, "ACE128map does not match encoderMap_87654321");
+
+#endif // ACE128map_h
@@ -0,0 +1,186 @@
+#ifndef ACE128store_h
+#define ACE128store_h
+/*
+  ACE128store.h - shared I2C EEPROM state store for many ACE128 encoders
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  Each ACE128 with its own eeAddr saves its state with its own little write transactions, and each of those
+  ties up the EEPROM for its ~5ms write cycle. With a panel full of knobs that adds up.
+  ACE128store instead packs the state of every registered encoder into page aligned records, so one page
+  write saves up to 10 encoders, and restores them all at startup with one sequential read.
+
+  Usage:
+    ACE128 knob1(0x20, (uint8_t*)encoderMap_87654321);  // no eeAddr - the store does the saving
+    ACE128 knob2(0x21, (uint8_t*)encoderMap_87654321);
+    ACE128store store(0);                                 // EEPROM area starting at page aligned address 0
+    setup():  store.add(knob1); store.add(knob2); knob1.begin(); knob2.begin(); store.begin();
+    loop():   read the knobs as usual, then store.update();
+
+  Each page holds ACE128_STORE_PER_PAGE records of 3 bytes: _mpos low byte, _mpos high byte, _zero.
+  Blank EEPROM reads 0xFF, which is not a valid zero, so encoders with no saved record keep the state begin() gave them.
+  Don't change the order of add() calls once state has been saved - an encoder's record is found by its index.
+*/
+
+#include "ACE128.h"
+#include <Wire.h>
+
+// Use these preprocessor #define statements to configure the store
+#ifndef ACE128_STORE_MAX
+  #define ACE128_STORE_MAX 16       // most encoders one store can hold
+#endif
+#ifndef ACE128_STORE_PAGE
+  #define ACE128_STORE_PAGE 32      // EEPROM page size in bytes, 32 for the 24CW160
+#endif
+#ifndef ACE128_STORE_WRITE_MS
+  #define ACE128_STORE_WRITE_MS 5   // EEPROM write cycle time
+#endif
+
+// the Wire buffer has to hold the 2 address bytes as well as the page
+#if defined(BUFFER_LENGTH) && (BUFFER_LENGTH - 2) < ACE128_STORE_PAGE
+  #define ACE128_STORE_PAGE_BYTES (BUFFER_LENGTH - 2)
+#else
+  #define ACE128_STORE_PAGE_BYTES ACE128_STORE_PAGE
+#endif
+#define ACE128_STORE_PER_PAGE (ACE128_STORE_PAGE_BYTES / 3)
+
+class ACE128store
+{
+  public:
+    ACE128store(uint16_t eeAddr, uint8_t i2caddr = 0x50); // page aligned EEPROM start address, EEPROM chip address
+    uint8_t add(ACE128 &encoder);  // register an encoder, returns its index or 0xFF if full
+    void begin();                  // restore every registered encoder, call after their begin() - or again later
+    void update();                 // write one changed page if the EEPROM is ready, call from loop()
+    void flush();                  // write every changed page now
+  private:
+    ACE128 *_enc[ACE128_STORE_MAX]; // registered encoders
+    int16_t _mpos[ACE128_STORE_MAX]; // _mpos as saved in EEPROM
+    uint8_t _zero[ACE128_STORE_MAX]; // _zero as saved in EEPROM
+    uint8_t _count;                // number of registered encoders
+    uint16_t _eeAddr;              // start of our EEPROM area
+    uint8_t _i2caddr;              // EEPROM chip address
+    unsigned long _written;        // millis() of the last page write
+    boolean _pageDirty(uint8_t page);
+    void _writePage(uint8_t page);
+    void _waitReady();
+};
+
+ACE128store::ACE128store(uint16_t eeAddr, uint8_t i2caddr)
+{
+  _eeAddr = eeAddr;
+  _i2caddr = i2caddr;
+  _count = 0;
+  _written = 0;
+}
+
+uint8_t ACE128store::add(ACE128 &encoder)
+{
+  if (_count >= ACE128_STORE_MAX) return (0xFF);
+  _enc[_count] = &encoder;
+  _mpos[_count] = 0;
+  _zero[_count] = 0xFF;            // nothing saved yet
+  return (_count++);
+}
+
+// read all the records with one address write followed by as many reads as the Wire buffer needs
+// the EEPROM address counter carries on from one read to the next, across page boundaries
+void ACE128store::begin()
+{
+  uint8_t pages = (_count + ACE128_STORE_PER_PAGE - 1) / ACE128_STORE_PER_PAGE;
+  uint16_t bytes = pages * ACE128_STORE_PAGE;
+  uint16_t offset = 0;
+  uint8_t rec[3];
+  uint8_t chunk;
+  Wire.beginTransmission(_i2caddr);
+  Wire.write((uint8_t) (_eeAddr >> 8));
+  Wire.write((uint8_t) _eeAddr );
+  Wire.endTransmission(false);
+  while (offset < bytes)
+  {
+    chunk = (bytes - offset > ACE128_STORE_PAGE_BYTES) ? ACE128_STORE_PAGE_BYTES : bytes - offset;
+    Wire.requestFrom((int)_i2caddr, (int)chunk);
+    for (uint8_t i = 0; i < chunk; i++, offset++)
+    {
+      uint8_t page = offset / ACE128_STORE_PAGE;
+      uint8_t inPage = offset % ACE128_STORE_PAGE;
+      uint8_t n = page * ACE128_STORE_PER_PAGE + inPage / 3;
+      rec[inPage % 3] = Wire.read();
+      if (inPage % 3 != 2 || inPage >= ACE128_STORE_PER_PAGE * 3 || n >= _count) continue;
+      _mpos[n] = rec[0] | (rec[1] << 8);
+      _zero[n] = rec[2];
+    }
+  }
+  // read each knob where it is now, once the records are in - a knob on the bus would reuse the Wire buffer
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    if (_zero[n] & 0x80) continue;     // blank - keep what begin() set up
+    _enc[n]->_restore(_zero[n], _mpos[n], _enc[n]->rawPos());
+  }
+}
+
+// does any encoder in this page differ from what we saved
+boolean ACE128store::_pageDirty(uint8_t page)
+{
+  for (uint8_t n = page * ACE128_STORE_PER_PAGE; n < _count && n < (page + 1) * ACE128_STORE_PER_PAGE; n++)
+  {
+    if (_enc[n]->_mpos != _mpos[n] || _enc[n]->_zero != _zero[n]) return (true);
+  }
+  return (false);
+}
+
+// one transaction, one write cycle, for up to ACE128_STORE_PER_PAGE encoders
+void ACE128store::_writePage(uint8_t page)
+{
+  uint16_t eeAddr = _eeAddr + page * ACE128_STORE_PAGE;
+  Wire.beginTransmission(_i2caddr);
+  Wire.write((uint8_t) (eeAddr >> 8));
+  Wire.write((uint8_t) eeAddr );
+  for (uint8_t n = page * ACE128_STORE_PER_PAGE; n < _count && n < (page + 1) * ACE128_STORE_PER_PAGE; n++)
+  {
+    _mpos[n] = _enc[n]->_mpos;
+    _zero[n] = _enc[n]->_zero;
+    Wire.write((uint8_t) _mpos[n] );
+    Wire.write((uint8_t) (_mpos[n] >> 8));
+    Wire.write(_zero[n]);
+  }
+  Wire.endTransmission();
+  _written = millis();
+}
+
+// doesn't block - at most one page per call, and only once the last write cycle is over
+void ACE128store::update()
+{
+  if (millis() - _written < ACE128_STORE_WRITE_MS) return;
+  for (uint8_t page = 0; page * ACE128_STORE_PER_PAGE < _count; page++)
+  {
+    if (_pageDirty(page))
+    {
+      _writePage(page);
+      return;
+    }
+  }
+}
+
+// the EEPROM doesn't acknowledge its address during a write cycle
+void ACE128store::_waitReady()
+{
+  if (millis() - _written > ACE128_STORE_WRITE_MS) return;
+  do
+  {
+    Wire.beginTransmission(_i2caddr);
+  } while (Wire.endTransmission() != 0 && millis() - _written <= ACE128_STORE_WRITE_MS);
+}
+
+void ACE128store::flush()
+{
+  for (uint8_t page = 0; page * ACE128_STORE_PER_PAGE < _count; page++)
+  {
+    if (_pageDirty(page))
+    {
+      _waitReady();
+      _writePage(page);
+    }
+  }
+}
+
+#endif // ACE128store_h
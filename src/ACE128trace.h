@@ -0,0 +1,198 @@
+#ifndef ACE128trace_h
+#define ACE128trace_h
+/*
+  ACE128trace.h - play back traces recorded with ACE128_TRACE
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  A trace holds every sample one encoder decoded while it was being traced, so a knob that misbehaves in the
+  field can be recorded and its samples run back through the library later, on the bench or on a desktop.
+  ACE128replay takes a trace a byte at a time and hands each sample to the encoder's own decoding, so zero,
+  reverse, recovery and turn counting all work as they did when it was recorded. Build the replaying encoder with
+  the same map and the same ACE128_RECOVER setting as the recording one. Velocity goes by the trace's clock, but
+  polling and the EEPROM journal go by millis(), so at replay speed they see the replay's clock.
+
+  Usage:
+    #define ACE128_TRACE in ACE128.h, then on the knob being recorded: knob.setTrace(&Serial); ... knob.setTrace(NULL);
+    ACE128 knob(0x20, (uint8_t*)encoderMap_87654321);  // never begin()'d - the trace sets it up
+    ACE128replay replay(knob, onSample);               // onSample(const ACE128sample &s) is called for every sample
+    while (more bytes) if (!replay.put(byte)) { the trace is broken }
+
+  Format, all multi-byte values little endian:
+    header          'A' 'C' 'E' 'T', version 1, then a state record
+    0ddddddd P      sample with pins P, d ms after the last record
+    0xC0 V P        sample with pins P, V ms after the last record
+    10nnnnnn V      n + 1 more samples with the last pins, the last of them V ms after the last record
+    0xC2 N V        N more samples with the last pins, the last of them V ms after the last record
+    0xC1 Z L M M    state: zero in bits 0 - 6 of Z, reverse in bit 7, last position L, multiturn offset M
+  V and N are unsigned LEB128 - 7 bits a byte, low bits first, top bit set on every byte but the last.
+  Sample times count from the start of the trace. Repeated samples between two records are spread evenly over the
+  time between them.
+*/
+
+#include "ACE128.h"
+
+#ifdef ACE128_TRACE
+
+// parser states
+#define ACE128_REPLAY_HEADER 0  // reading the magic bytes and version
+#define ACE128_REPLAY_TAG    1  // waiting for a record
+#define ACE128_REPLAY_PINS   2  // waiting for the pins of a sample
+#define ACE128_REPLAY_COUNT  3  // reading the N of an idle record
+#define ACE128_REPLAY_TIME   4  // reading a V
+#define ACE128_REPLAY_STATE  5  // reading the 4 bytes of a state record
+#define ACE128_REPLAY_BROKEN 6  // bad byte seen, nothing more is replayed
+
+class ACE128replay
+{
+  public:
+    ACE128replay(ACE128 &encoder, void (*onSample)(const ACE128sample &s) = NULL);
+    boolean put(uint8_t b);        // next byte of the trace, false if the trace is broken
+    unsigned long samples();       // samples replayed so far
+    const ACE128sample &last();    // the last sample replayed
+  private:
+    ACE128 *_enc;                  // encoder the samples go through
+    void (*_onSample)(const ACE128sample &s);
+    uint8_t _state;                // parser state
+    uint8_t _tag;                  // record being read
+    uint8_t _n;                    // bytes of the header or state record read so far
+    uint8_t _buf[4];               // state record
+    uint8_t _shift;                // bit position in the LEB128 value being read
+    unsigned long _value;          // LEB128 value being read
+    unsigned long _count;          // repeats in the run being read
+    unsigned long _ms;             // time of the last record
+    uint8_t _pins;                 // pins of the last sample
+    unsigned long _samples;
+    ACE128sample _last;
+    boolean _varint(uint8_t b);    // add a byte to _value, true when it is complete
+    void _replay(uint8_t pins, unsigned long ms);
+};
+
+ACE128replay::ACE128replay(ACE128 &encoder, void (*onSample)(const ACE128sample &s))
+{
+  _enc = &encoder;
+  _onSample = onSample;
+  _state = ACE128_REPLAY_HEADER;
+  _n = 0;
+  _ms = 0;
+  _pins = 0;
+  _samples = 0;
+  _last = ACE128sample();
+}
+
+boolean ACE128replay::_varint(uint8_t b)
+{
+  if (_shift >= 32) return (true);   // too long to be ours - keep the low bits
+  _value |= (unsigned long)(b & 0x7F) << _shift;
+  _shift += 7;
+  return (!(b & 0x80));
+}
+
+void ACE128replay::_replay(uint8_t pins, unsigned long ms)
+{
+  _last = _enc->_sample(pins, ms);
+  _samples++;
+  if (_onSample != NULL) _onSample(_last);
+}
+
+boolean ACE128replay::put(uint8_t b)
+{
+  switch (_state)
+  {
+    case ACE128_REPLAY_HEADER:
+      if (b != (_n < 4 ? (uint8_t)"ACET"[_n] : ACE128_TRACE_VERSION)) break;
+      if (++_n == 5) _state = ACE128_REPLAY_TAG;
+      return (true);
+    case ACE128_REPLAY_TAG:
+      _tag = b;
+      _value = 0;
+      _shift = 0;
+      if (b < 0x80)
+      {
+        _value = b;
+        _state = ACE128_REPLAY_PINS;
+      }
+      else if (b < ACE128_TRACE_LONG)
+      {
+        _count = (b & 0x3F) + 1;
+        _state = ACE128_REPLAY_TIME;
+      }
+      else if (b == ACE128_TRACE_LONG)
+      {
+        _state = ACE128_REPLAY_TIME;
+      }
+      else if (b == ACE128_TRACE_IDLE)
+      {
+        _state = ACE128_REPLAY_COUNT;
+      }
+      else if (b == ACE128_TRACE_STATE)
+      {
+        _n = 0;
+        _state = ACE128_REPLAY_STATE;
+      }
+      else
+      {
+        break;
+      }
+      return (true);
+    case ACE128_REPLAY_COUNT:
+      if (_varint(b))
+      {
+        if (_value == 0) break;    // a run of nothing
+        _count = _value;
+        _value = 0;
+        _shift = 0;
+        _state = ACE128_REPLAY_TIME;
+      }
+      return (true);
+    case ACE128_REPLAY_TIME:
+      if (!_varint(b)) return (true);
+      if (_tag == ACE128_TRACE_LONG)
+      {
+        _state = ACE128_REPLAY_PINS;
+        return (true);
+      }
+      // a run - the last one lands on the record's time, the rest evenly before it
+      for (unsigned long i = 1; i <= _count; i++)
+      {
+        _replay(_pins, _ms + _value / _count * i + _value % _count * i / _count);
+      }
+      _ms += _value;
+      _state = ACE128_REPLAY_TAG;
+      return (true);
+    case ACE128_REPLAY_PINS:
+      _pins = b;
+      _ms += _value;
+      _replay(_pins, _ms);
+      _state = ACE128_REPLAY_TAG;
+      return (true);
+    case ACE128_REPLAY_STATE:
+      _buf[_n++] = b;
+      if (_n < 4) return (true);
+      _enc->_zero = _buf[0] & 0x7F;
+      _enc->_reverse = (_buf[0] & 0x80) ? true : false;
+      _enc->_lastpos = (int8_t)_buf[1];
+      _enc->_mpos = (int16_t)(_buf[2] | (_buf[3] << 8));
+    #ifdef ACE128_QUEUE
+      _enc->_queue_sync();
+    #endif
+      _state = ACE128_REPLAY_TAG;
+      return (true);
+  }
+  _state = ACE128_REPLAY_BROKEN;
+  return (false);
+}
+
+unsigned long ACE128replay::samples()
+{
+  return (_samples);
+}
+
+const ACE128sample &ACE128replay::last()
+{
+  return (_last);
+}
+
+#endif // ACE128_TRACE
+
+#endif // ACE128trace_h
@@ -0,0 +1,67 @@
+#ifndef ACE128wire_h
+#define ACE128wire_h
+/*
+  ACE128wire.h - I2C expander setup shared by ACE128 and ACE128bank
+  Copyright (c) 2013-2019 Alastair Young.
+  This project is licensed under the terms of the MIT license.
+
+  ACE128.h pulls this in when it uses the bus, ACE128bank.h always does. There is nothing here for
+  sketches to call.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// MCP23008 IO expander
+#define ACE128_MCP23008_ADDRESS 0x20
+#define ACE128_MCP23008_IODIR   0x00
+#define ACE128_MCP23008_IPOL    0x01
+#define ACE128_MCP23008_GPINTEN 0x02
+#define ACE128_MCP23008_DEFVAL  0x03
+#define ACE128_MCP23008_INTCON  0x04
+#define ACE128_MCP23008_IOCON   0x05
+#define ACE128_MCP23008_GPPU    0x06
+#define ACE128_MCP23008_INTF    0x07
+#define ACE128_MCP23008_INTCAP  0x08
+#define ACE128_MCP23008_GPIO    0x09
+#define ACE128_MCP23008_OLAT    0x0A
+#define ACE128_MCP23008_SEQOP   0x20  // IOCON bits
+#define ACE128_MCP23008_ODR     0x04
+
+// Set up the MCP23008 at addr as 8 inputs with pullups, and leave its register pointer on GPIO with SEQOP set
+// so that every read after this is a single requestFrom(). With interrupt it also drives INT, open drain so
+// several chips can share the pin, on any change. Returns false if the chip didn't answer.
+boolean ACE128_mcp23008_begin(uint8_t addr, boolean interrupt = false)
+{
+  uint8_t iocon = interrupt ? ACE128_MCP23008_ODR : 0x00;
+  // a reset that left the chip powered leaves SEQOP set, which would pile the whole blast below into IODIR
+  Wire.beginTransmission(addr);
+  Wire.write((uint8_t)ACE128_MCP23008_IOCON);
+  Wire.write((uint8_t)0x00);  // IOCON no special config
+  Wire.endTransmission();
+  Wire.beginTransmission(addr);
+  Wire.write((uint8_t)ACE128_MCP23008_IODIR); // MCP23008 lets us blast all registers
+  Wire.write((uint8_t)0xFF);  // IODIR all inputs
+  Wire.write((uint8_t)0x00);  // IPOL  do not invert
+  Wire.write((uint8_t)(interrupt ? 0xFF : 0x00));  // GPINTEN interrupt on all pins, or none
+  Wire.write((uint8_t)0x00);  // DEFVAL not used
+  Wire.write((uint8_t)0x00);  // INTCON compare against previous value i.e. any change
+  Wire.write(iocon);          // IOCON
+  Wire.write((uint8_t)0xFF);  // GPPU pullup all inputs
+  Wire.write((uint8_t)0x00);  // INTF disabled
+  Wire.write((uint8_t)0x00);  // INTCAP disabled
+  Wire.write((uint8_t)0x00);  // GPIO
+  Wire.write((uint8_t)0x00);  // OLAT
+  Wire.endTransmission();
+  // now stop the register pointer from moving on after each byte. This can't go in the blast above
+  // as it would stop the blast at IOCON
+  Wire.beginTransmission(addr);
+  Wire.write((uint8_t)ACE128_MCP23008_IOCON);
+  Wire.write((uint8_t)(iocon | ACE128_MCP23008_SEQOP));
+  Wire.endTransmission();
+  Wire.beginTransmission(addr);
+  Wire.write((uint8_t)ACE128_MCP23008_GPIO);
+  return (Wire.endTransmission() == 0);
+}
+
+#endif // ACE128wire_h